@@ -0,0 +1,196 @@
+#include "analyzer.h"
+#include "parallel.h"
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+const int binsPerUnit = 16;
+// The largest possible difference is sqrt(3) * 255.
+const size_t numBins = static_cast<size_t>(442 * binsPerUnit);
+
+// Thread local results.
+struct Partial
+{
+	Partial() : unfilled(0), duplicates(0), sum(0), scoreSum(0), max(0), count(0),
+		histogram(numBins, 0) {}
+	size_t unfilled;
+	size_t duplicates;
+	double sum;
+	double scoreSum;
+	double max;
+	size_t count;
+	vector<size_t> histogram;
+};
+
+// One row converted to floats, padded by one pixel on both sides,
+// so the neighbour loops below have no branches and vectorize.
+struct FloatRow
+{
+	explicit FloatRow(int cols) : b(cols + 2, 0), g(cols + 2, 0), r(cols + 2, 0), filled(cols + 2, 0) {}
+	void Load(const Mat& image, PosComponent y)
+	{
+		fill(filled.begin(), filled.end(), 0.0f);
+		if (y < 0 || y >= image.rows)
+			return;
+		const Channel* pixel = image.ptr(y);
+		for (int x = 0; x < image.cols; ++x, pixel += 3)
+		{
+			b[x + 1] = pixel[0];
+			g[x + 1] = pixel[1];
+			r[x + 1] = pixel[2];
+			filled[x + 1] = pixel[0] != invalidColor ? 1.0f : 0.0f;
+		}
+	}
+	vector<float> b, g, r, filled;
+};
+
+// Adds the differences of the pixels of center to their neighbours
+// at dx - 1 in other, if those are filled.
+void AddDifferences(const FloatRow& center, const FloatRow& other, int dx, int cols,
+					float* __restrict sums, float* __restrict counts)
+{
+	const float* __restrict cb = &center.b[1];
+	const float* __restrict cg = &center.g[1];
+	const float* __restrict cr = &center.r[1];
+	const float* __restrict ob = &other.b[dx];
+	const float* __restrict og = &other.g[dx];
+	const float* __restrict orr = &other.r[dx];
+	const float* __restrict of = &other.filled[dx];
+	for (int x = 0; x < cols; ++x)
+	{
+		float db = cb[x] - ob[x];
+		float dg = cg[x] - og[x];
+		float dr = cr[x] - orr[x];
+		sums[x] += std::sqrt(db*db + dg*dg + dr*dr) * of[x];
+		counts[x] += of[x];
+	}
+}
+
+double Percentile(const vector<size_t>& histogram, size_t count, double fraction)
+{
+	size_t rank = static_cast<size_t>(ceil(fraction * count));
+	size_t seen = 0;
+	for (size_t bin = 0; bin < histogram.size(); ++bin)
+	{
+		seen += histogram[bin];
+		if (seen >= max<size_t>(rank, 1))
+			return static_cast<double>(bin + 1) / binsPerUnit;
+	}
+	return 0;
+}
+
+}
+
+Analysis Analyze(const Mat& image)
+{
+	unique_ptr<atomic<uint64_t>[]> bitmap(new atomic<uint64_t>[(1 << 24) / 64]);
+	for (size_t i = 0; i < (1 << 24) / 64; ++i)
+		bitmap[i].store(0, memory_order_relaxed);
+
+	vector<Partial> partials(NumThreads());
+	atomic<size_t> nextPartial(0);
+	ParallelFor(image.rows, [&](size_t begin, size_t end)
+	{
+		Partial& partial = partials[nextPartial++];
+		FloatRow rows[3] = {FloatRow(image.cols), FloatRow(image.cols), FloatRow(image.cols)};
+		vector<float> sums(image.cols), counts(image.cols);
+		for (PosComponent y = begin; y < static_cast<PosComponent>(end); ++y)
+		{
+			for (int i = 0; i < 3; ++i)
+				rows[i].Load(image, y - 1 + i);
+			const FloatRow& center = rows[1];
+			fill(sums.begin(), sums.end(), 0.0f);
+			fill(counts.begin(), counts.end(), 0.0f);
+			for (int dy = 0; dy < 3; ++dy)
+			{
+				for (int dx = 0; dx < 3; ++dx)
+				{
+					if (dy == 1 && dx == 1)
+						continue;
+					AddDifferences(center, rows[dy], dx, image.cols, &sums[0], &counts[0]);
+				}
+			}
+			const Channel* pixel = image.ptr(y);
+			for (int x = 0; x < image.cols; ++x, pixel += 3)
+			{
+				if (pixel[0] == invalidColor)
+				{
+					++partial.unfilled;
+					continue;
+				}
+				uint32_t color = pixel[2] << 16 | pixel[1] << 8 | pixel[0];
+				uint64_t bit = uint64_t(1) << (color % 64);
+				if (bitmap[color / 64].fetch_or(bit, memory_order_relaxed) & bit)
+					++partial.duplicates;
+				if (counts[x] == 0)
+					continue;
+				double diff = sums[x] / counts[x];
+				partial.sum += diff;
+				partial.scoreSum += diff / counts[x];
+				partial.max = max(partial.max, diff);
+				++partial.count;
+				++partial.histogram[min(static_cast<size_t>(diff * binsPerUnit), numBins - 1)];
+			}
+		}
+	});
+
+	Analysis analysis = Analysis();
+	analysis.pixels = image.total();
+	double sum = 0;
+	double scoreSum = 0;
+	size_t count = 0;
+	vector<size_t> histogram(numBins, 0);
+	for (const Partial& partial : partials)
+	{
+		analysis.unfilled += partial.unfilled;
+		analysis.duplicates += partial.duplicates;
+		sum += partial.sum;
+		scoreSum += partial.scoreSum;
+		analysis.maxDiff = max(analysis.maxDiff, partial.max);
+		count += partial.count;
+		for (size_t bin = 0; bin < numBins; ++bin)
+			histogram[bin] += partial.histogram[bin];
+	}
+	analysis.distinctColors = analysis.pixels - analysis.unfilled - analysis.duplicates;
+	if (count)
+	{
+		analysis.meanDiff = sum / count;
+		analysis.p50Diff = Percentile(histogram, count, 0.5);
+		analysis.p90Diff = Percentile(histogram, count, 0.9);
+		analysis.p99Diff = Percentile(histogram, count, 0.99);
+		analysis.meanScore = scoreSum / count;
+	}
+	return analysis;
+}
+
+void PrintAnalysis(const Analysis& analysis)
+{
+	cout << "Pixels: " << analysis.pixels << ", unfilled: " << analysis.unfilled << endl
+		<< "Distinct colors: " << analysis.distinctColors
+		<< ", duplicates: " << analysis.duplicates << endl
+		<< "Neighbour difference mean: " << analysis.meanDiff
+		<< ", p50: " << analysis.p50Diff << ", p90: " << analysis.p90Diff
+		<< ", p99: " << analysis.p99Diff << ", max: " << analysis.maxDiff << endl
+		<< "Placement score (sum / n^2) mean: " << analysis.meanScore << endl;
+}
+
+bool AnalyzeFile(const string& path)
+{
+	Mat image = imread(path, IMREAD_COLOR);
+	if (!image.rows)
+	{
+		cout << "Could not load " << path << endl;
+		return false;
+	}
+	PrintAnalysis(Analyze(image));
+	return true;
+}
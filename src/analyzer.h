@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common.h"
+
+#include <cstddef>
+#include <string>
+
+// Quality metrics of a (not embellished) canvas.
+struct Analysis
+{
+	std::size_t pixels;
+	std::size_t unfilled; // Pixels with the invalid color.
+	std::size_t distinctColors;
+	std::size_t duplicates; // Filled pixels whose color occurred before.
+	// Per filled pixel with filled neighbours, the mean color difference
+	// to them (sum / n), and its distribution.
+	double meanDiff;
+	double p50Diff;
+	double p90Diff;
+	double p99Diff;
+	double maxDiff; // Exact, not a histogram bin.
+	// Mean of sum / n^2 over the same pixels, the score ColorPosDiff
+	// gives a color at its position, i.e. what the engines minimize.
+	double meanScore;
+};
+
+// Runs on all cores. Colors are checked with a 2^24 bit bitmap, the
+// percentiles come from histograms with 1/16 resolution.
+Analysis Analyze(const cv::Mat& image);
+
+void PrintAnalysis(const Analysis& analysis);
+
+// Loads and analyzes a finished image, false if it cannot be read.
+bool AnalyzeFile(const std::string& path);
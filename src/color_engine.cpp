@@ -0,0 +1,141 @@
+#include "color_engine.h"
+#include "compactness.h"
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using namespace cv;
+using namespace std;
+
+Pos FindBestPos(const Mat& image, const Frontier& nextPositions, Color color,
+				mt19937& g, double divisorExponent)
+{
+	double best = numeric_limits<double>::infinity();
+	vector<Pos> ties;
+	for (const Pos& pos : nextPositions)
+	{
+		double diff = ColorPosDiff(image, pos, color, divisorExponent);
+		if (diff < best)
+		{
+			best = diff;
+			ties.assign(1, pos);
+		}
+		else if (diff == best)
+			ties.push_back(pos);
+	}
+
+	// The tie is broken as by shuffling the positions in sorted order and
+	// taking the first best one, so the choice and the use of g do not
+	// depend on the order of the frontier. Ranks are the sorted indices.
+	sort(ties.begin(), ties.end());
+	vector<size_t> ranks(ties.size() + 1, 0);
+	for (const Pos& pos : nextPositions)
+		++ranks[upper_bound(ties.begin(), ties.end(), pos) - ties.begin()];
+	// ranks[i] counts the positions from tie i - 1 up to tie i,
+	// so the prefix sums are the numbers of positions before the ties.
+	partial_sum(ranks.begin(), ranks.end(), ranks.begin());
+	ranks.pop_back();
+
+	vector<size_t> order(nextPositions.Size());
+	iota(order.begin(), order.end(), size_t(0));
+	shuffle(order.begin(), order.end(), g);
+	for (size_t rank : order)
+	{
+		auto it = lower_bound(ranks.begin(), ranks.end(), rank);
+		if (it != ranks.end() && *it == rank)
+			return ties[it - ranks.begin()];
+	}
+	return ties.front();
+}
+
+CandidateSampler::CandidateSampler(double quality, SearchMode search) :
+	exact_(quality >= 1),
+	budget_(static_cast<size_t>(minCandidates * pow(2.0, 12 * quality)))
+{
+	if (search != SearchMode::Random)
+		dispatcher_.reset(new SearchDispatcher(search));
+}
+
+void CandidateSampler::Placed(const Pos& pos)
+{
+	if (exact_)
+		return;
+	recent_.push_front(pos);
+	if (recent_.size() > numRecent)
+		recent_.pop_back();
+}
+
+Pos CandidateSampler::FindBestPos(const Mat& image, const Frontier& nextPositions,
+								  Color color, mt19937& g, double divisorExponent)
+{
+	if (exact_ || nextPositions.Size() <= budget_)
+	{
+		if (dispatcher_)
+			return dispatcher_->FindBestPos(image, nextPositions, color, divisorExponent);
+		return ::FindBestPos(image, nextPositions, color, g, divisorExponent);
+	}
+
+	candidates_.clear();
+	for (const Pos& pos : recent_)
+	{
+		for (PosComponent y = pos.second - recentRadius; y <= pos.second + recentRadius; ++y)
+		{
+			for (PosComponent x = pos.first - recentRadius; x <= pos.first + recentRadius; ++x)
+			{
+				Pos candidate(x, y);
+				if (candidates_.size() < budget_ / 2 && IsInside(image, x, y) &&
+					nextPositions.Contains(candidate))
+					candidates_.push_back(candidate);
+			}
+		}
+	}
+	uniform_int_distribution<size_t> distribution(0, nextPositions.Size() - 1);
+	while (candidates_.size() < budget_)
+		candidates_.push_back(nextPositions[distribution(g)]);
+
+	double best = numeric_limits<double>::infinity();
+	Pos bestPos;
+	for (const Pos& pos : candidates_)
+	{
+		double diff = ColorPosDiff(image, pos, color, divisorExponent);
+		if (diff < best)
+		{
+			best = diff;
+			bestPos = pos;
+		}
+	}
+	return bestPos;
+}
+
+void GrowColorDriven(Mat& image, const set<Pos>& initPositions,
+					 ColorRuns& colors, const ColorEngineSettings& settings,
+					 mt19937& g, SnapshotWriter& snapshots,
+					 const PlacementCallback& onPlaced)
+{
+	Frontier nextPositions(image.size());
+	for (const Pos& pos : initPositions)
+		nextPositions.Insert(pos);
+	CandidateSampler sampler(settings.quality, settings.search);
+	CompactnessController compactness(settings.frontierTarget);
+
+	while (!colors.Empty() && !nextPositions.Empty())
+	{
+		Color color = colors.Back();
+		colors.PopBack();
+		Pos pos = sampler.FindBestPos(image, nextPositions, color, g,
+									  compactness.Exponent());
+		assert(nextPositions.Contains(pos));
+		nextPositions.Erase(pos);
+		SetPixel(image, pos.first, pos.second, color);
+		snapshots.Placed(pos, color);
+		sampler.Placed(pos);
+		if (onPlaced)
+			onPlaced(pos, colors.Size());
+		for (const Pos& freePos : GetFreeNeighbours(image, pos))
+			nextPositions.Insert(freePos);
+		compactness.Update(nextPositions.Size());
+		snapshots.Update(image, colors.Size(), nextPositions.Size());
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "common.h"
+#include "frontier.h"
+#include "output.h"
+#include "palette.h"
+#include "search.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+// Exact search over the whole frontier, ties are broken randomly.
+Pos FindBestPos(const cv::Mat& image, const Frontier& nextPositions,
+				Color color, std::mt19937& g, double divisorExponent = 2);
+
+// Approximate FindBestPos with a fixed number of candidates per color.
+// Half of them are the frontier positions around the last placements,
+// since the hue sorted colors tend to land next to each other,
+// the rest are drawn uniformly from the whole frontier.
+class CandidateSampler
+{
+public:
+	// quality 1 is the exact search, quality 0 evaluates
+	// minCandidates positions, and the count doubles every 1/12 step.
+	// Exact searches use FindBestPos for SearchMode::Random,
+	// else a SearchDispatcher.
+	explicit CandidateSampler(double quality, SearchMode search = SearchMode::Random);
+	void Placed(const Pos& pos);
+	Pos FindBestPos(const cv::Mat& image, const Frontier& nextPositions,
+					Color color, std::mt19937& g, double divisorExponent);
+private:
+	static const std::size_t minCandidates = 16;
+	static const std::size_t numRecent = 4;
+	static const PosComponent recentRadius = 2;
+	bool exact_;
+	std::size_t budget_;
+	std::deque<Pos> recent_;
+	std::vector<Pos> candidates_;
+	std::unique_ptr<SearchDispatcher> dispatcher_;
+};
+
+// Called with the position and the index (in the expanded colors)
+// of every placed color.
+typedef std::function<void(const Pos&, std::size_t)> PlacementCallback;
+
+struct ColorEngineSettings
+{
+	ColorEngineSettings() : quality(1), frontierTarget(0), search(SearchMode::Random) {}
+	double quality; // See CandidateSampler.
+	std::size_t frontierTarget; // See CompactnessController, 0 = off.
+	SearchMode search; // Exact search, see CandidateSampler.
+};
+
+// Pops the colors from the back and places each one at the frontier
+// position it fits best.
+void GrowColorDriven(cv::Mat& image, const std::set<Pos>& initPositions,
+					 ColorRuns& colors,
+					 const ColorEngineSettings& settings,
+					 std::mt19937& g, SnapshotWriter& snapshots,
+					 const PlacementCallback& onPlaced = PlacementCallback());
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+
+// Helpers for bucket grids over the RGB cube with 2^cellBits wide cells.
+template<int cellBits>
+struct ColorGrid
+{
+	static const int cellWidth = 1 << cellBits;
+	static const int cellsPerAxis = 256 >> cellBits;
+	static const std::size_t numCells =
+		static_cast<std::size_t>(cellsPerAxis) * cellsPerAxis * cellsPerAxis;
+
+	static std::size_t CellIndex(int b, int g, int r)
+	{
+		return (static_cast<std::size_t>(b) * cellsPerAxis + g) * cellsPerAxis + r;
+	}
+
+	static std::size_t CellIndex(const Color& color)
+	{
+		return CellIndex(color[0] >> cellBits, color[1] >> cellBits,
+						 color[2] >> cellBits);
+	}
+
+	// Visits the cells in shells of growing Chebyshev distance around the
+	// cell of query. Before every shell, done(bound) is asked whether to stop,
+	// bound being a lower bound of the distance from query to any color
+	// in the shell. Stops by itself once the shells leave the cube.
+	template<class Visit, class Done>
+	static void VisitShells(const ColorDouble& query, Visit visit, Done done)
+	{
+		const double inf = std::numeric_limits<double>::infinity();
+		int qc[3];
+		for (int c = 0; c < 3; ++c)
+			qc[c] = std::min(std::max(static_cast<int>(query[c]) >> cellBits, 0),
+							 cellsPerAxis - 1);
+
+		for (int r = 0; r < cellsPerAxis; ++r)
+		{
+			double bound = r ? inf : 0;
+			for (int c = 0; r && c < 3; ++c)
+			{
+				if (qc[c] - r >= 0)
+					bound = std::min(bound, query[c] - (qc[c] - r + 1) * cellWidth);
+				if (qc[c] + r < cellsPerAxis)
+					bound = std::min(bound, (qc[c] + r) * cellWidth - query[c]);
+			}
+			if (bound == inf)
+				return; // The shell lies completely outside of the cube.
+			if (done(std::max(bound, 0.0)))
+				return;
+
+			int lo[3], hi[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				lo[c] = std::max(qc[c] - r, 0);
+				hi[c] = std::min(qc[c] + r, cellsPerAxis - 1);
+			}
+			for (int b = lo[0]; b <= hi[0]; ++b)
+			{
+				for (int g = lo[1]; g <= hi[1]; ++g)
+				{
+					if (std::abs(b - qc[0]) == r || std::abs(g - qc[1]) == r)
+					{
+						for (int rr = lo[2]; rr <= hi[2]; ++rr)
+							visit(CellIndex(b, g, rr));
+						continue;
+					}
+					if (qc[2] - r >= 0)
+						visit(CellIndex(b, g, qc[2] - r));
+					if (r && qc[2] + r < cellsPerAxis)
+						visit(CellIndex(b, g, qc[2] + r));
+				}
+			}
+		}
+	}
+};
@@ -0,0 +1,76 @@
+#include "common.h"
+
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+set<Pos> GetFreeNeighbours(const Mat& image, Pos pos)
+{
+	PosComponent x, y;
+	tie(x, y) = pos;
+	vector<Pos> neighbours;
+	neighbours.reserve(8);
+	for (PosComponent nx = x-spread; nx <= x+spread; ++nx)
+		for (PosComponent ny = y-spread; ny <= y+spread; ++ny)
+			neighbours.push_back(Pos(nx, ny));
+	set<Pos> result;
+	copy_if(neighbours.begin(), neighbours.end(), inserter(result, result.begin()), [&image](Pos pos) -> bool
+	{
+		PosComponent x, y;
+		tie(x, y) = pos;
+		if (!IsInside(image, x, y))
+			return false;
+		return IsFree(image, x, y);
+	});
+	return result;
+}
+
+ColorDouble bgr2hsv(Color bgr)
+{
+	Channel bc = bgr[0];
+	Channel gc = bgr[1];
+	Channel rc = bgr[2];
+	double b = bc / 255.0;
+	double g = gc / 255.0;
+	double r = rc / 255.0;
+	Channel maxc = max3(rc, gc, bc);
+	double v = max3(r, g, b);
+	double s = v == 0 ? 0 : (v - min3(r, g, b))/v;
+	double h = 0;
+	double divisor = v - min3(r, g, b);
+	if (divisor == 0)
+		return ColorDouble(0, 0, 0);
+	if (maxc == rc)
+		h = 60*(g-b)/divisor;
+	else if (maxc == gc)
+		h = 120 + 60*(b-r)/divisor;
+	else if (maxc == bc)
+		h = 240 + 60*(r-g)/divisor;
+	else
+		assert(false); // If we land here our v is incorrect.
+	if (h < 0)
+		h += 360;
+	return ColorDouble(h, s, v);
+}
+
+uint32_t MortonCode(const Color& color)
+{
+	uint32_t code = 0;
+	for (int bit = 7; bit >= 0; --bit)
+		for (int c = 0; c < 3; ++c)
+			code = (code << 1) | ((color[c] >> bit) & 1);
+	return code;
+}
+
+void SortByHue(vector<Color>& colors)
+{
+	sort(colors.begin(), colors.end(), [](Color bgr1, Color bgr2) -> bool
+	{
+		ColorDouble hsv1 = bgr2hsv(bgr1);
+		ColorDouble hsv2 = bgr2hsv(bgr2);
+		return hsv1[0] < hsv2[0];
+	});
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "image.h"
+
+typedef unsigned char Channel;
+typedef int PosComponent;
+
+const int ImageType = CV_8UC3;
+
+typedef cv::Vec<double, 3> ColorDouble;
+typedef cv::Vec<Channel, 3> Color;
+typedef std::pair<PosComponent, PosComponent> Pos;
+
+const Channel invalidColor = 0;
+
+const PosComponent spread = 1;
+
+inline void SetPixel(cv::Mat& image, PosComponent x, PosComponent y, const Color& color)
+{
+	image.at<Color>(y, x) = color;
+}
+
+inline Color GetPixel(const cv::Mat& image, PosComponent x, PosComponent y)
+{
+	return image.at<Color>(y, x);
+}
+
+inline Color GetPixel(const cv::Mat& image, const Pos& pos)
+{
+	return GetPixel(image, pos.first, pos.second);
+}
+
+inline bool IsInside(const cv::Mat& image, PosComponent x, PosComponent y)
+{
+	return x >= 0 && x < image.cols && y >= 0 && y < image.rows;
+}
+
+inline bool IsFree(const cv::Mat& image, PosComponent x, PosComponent y)
+{
+	return GetPixel(image, x, y)[0] == invalidColor;
+}
+
+template<class T>
+const T& min3(const T& a, const T& b, const T& c)
+{
+    return std::min(std::min(a, b), c);
+}
+
+template<class T>
+const T& max3(const T& a, const T& b, const T& c)
+{
+    return std::max(std::max(a, b), c);
+}
+
+ColorDouble bgr2hsv(Color bgr);
+
+inline double ColorDiff(Color bgr1, Color bgr2)
+{
+	double db = bgr2[0] - bgr1[0];
+	double dg = bgr2[1] - bgr1[1];
+	double dr = bgr2[2] - bgr1[2];
+	return std::sqrt(db*db + dg*dg + dr*dr);
+}
+
+// Collects the already filled pixels of the 8-neighbourhood of pos
+// into neighbours (room for 9) and returns their count.
+inline int FilledNeighbours(const cv::Mat& image, Pos pos, Color* neighbours)
+{
+	PosComponent x, y;
+	std::tie(x, y) = pos;
+
+	int colorCount = 0;
+	for (PosComponent nx = x-spread; nx <= x+spread; ++nx)
+	{
+		for (PosComponent ny = y-spread; ny <= y+spread; ++ny)
+		{
+			if (!IsInside(image, nx, ny))
+				continue;
+			Color pixelColor = GetPixel(image, nx, ny);
+			if (pixelColor[0] == invalidColor)
+				continue;
+			neighbours[colorCount++] = pixelColor;
+		}
+	}
+	return colorCount;
+}
+
+inline double ColorPosDiff(const Color* neighbours, int colorCount, Color color)
+{
+	double diff = 0;
+	for (int i = 0; i < colorCount; ++i)
+		diff += ColorDiff(color, neighbours[i]);
+	// Avoid division by zero.
+	double divisor = std::max(colorCount, 1);
+	// Square divisor to avoid coral like growing.
+	// This also reduces the number of currently open border pixels.
+	return diff/(divisor*divisor);
+}
+
+inline double ColorPosDiff(const cv::Mat& image, Pos pos, Color color)
+{
+	Color neighbours[9];
+	int colorCount = FilledNeighbours(image, pos, neighbours);
+	return ColorPosDiff(neighbours, colorCount, color);
+}
+
+// ColorPosDiff with an adjustable exponent of the divisor.
+// Higher exponents favour positions with more filled neighbours.
+inline double ColorPosDiff(const cv::Mat& image, Pos pos, Color color,
+						   double divisorExponent)
+{
+	if (divisorExponent == 2)
+		return ColorPosDiff(image, pos, color);
+	Color neighbours[9];
+	int colorCount = FilledNeighbours(image, pos, neighbours);
+	double diff = 0;
+	for (int i = 0; i < colorCount; ++i)
+		diff += ColorDiff(color, neighbours[i]);
+	return diff/std::pow(std::max(colorCount, 1), divisorExponent);
+}
+
+// Blends the neighbourhood difference with the difference
+// to the color of a target image at pos.
+inline double ColorPosDiff(const cv::Mat& image, const cv::Mat& target,
+						   double targetWeight, Pos pos, Color color)
+{
+	return (1 - targetWeight) * ColorPosDiff(image, pos, color)
+		+ targetWeight * ColorDiff(color, GetPixel(target, pos));
+}
+
+// Order of rated positions for the deterministic exact searches,
+// ties are broken by position.
+inline bool IsBetter(double diff, const Pos& pos, double bestDiff, const Pos& bestPos)
+{
+	return diff < bestDiff || (diff == bestDiff && pos < bestPos);
+}
+
+std::set<Pos> GetFreeNeighbours(const cv::Mat& image, Pos pos);
+
+// Interleaved channel bits, close codes are close in the RGB cube.
+std::uint32_t MortonCode(const Color& color);
+
+// Sort colors by hue, so they can be popped from the back.
+void SortByHue(std::vector<Color>& colors);
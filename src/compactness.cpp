@@ -0,0 +1,36 @@
+#include "compactness.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+constexpr double CompactnessController::minExponent;
+constexpr double CompactnessController::maxExponent;
+constexpr double CompactnessController::gain;
+
+CompactnessController::CompactnessController(size_t targetSize,
+											 const string& logPath) :
+	targetSize_(targetSize),
+	placements_(0),
+	exponent_(minExponent)
+{
+	if (targetSize_)
+		log_.open(logPath);
+}
+
+void CompactnessController::Update(size_t frontierSize)
+{
+	if (!targetSize_ || ++placements_ % updateEvery)
+		return;
+	// Proportional step on the relative deviation from the target.
+	double error = static_cast<double>(frontierSize) / targetSize_ - 1;
+	double exponent = exponent_ + gain * error;
+	exponent = min(max(exponent, minExponent), maxExponent);
+	// Coarse steps keep the unchanged case on the exact square.
+	exponent = round(exponent * 64) / 64;
+	if (exponent == exponent_)
+		return;
+	exponent_ = exponent;
+	log_ << placements_ << " " << frontierSize << " " << exponent_ << endl;
+}
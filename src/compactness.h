@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+// Keeps the frontier of the color engine near a target size by adapting
+// the exponent of the neighbour count divisor in ColorPosDiff.
+// A growing frontier raises the exponent, which favours well surrounded
+// positions and closes holes, a small one lowers it back to the square.
+// Every change is logged as "placements frontierSize exponent".
+class CompactnessController
+{
+public:
+	// targetSize 0 disables the controller, the exponent stays 2.
+	explicit CompactnessController(std::size_t targetSize,
+		const std::string& logPath = "./output/compactness.log");
+	double Exponent() const { return exponent_; }
+	// Called after every placement.
+	void Update(std::size_t frontierSize);
+private:
+	static const std::size_t updateEvery = 256;
+	static constexpr double minExponent = 2;
+	static constexpr double maxExponent = 6;
+	static constexpr double gain = 0.5;
+	std::size_t targetSize_;
+	std::size_t placements_;
+	double exponent_;
+	std::ofstream log_;
+};
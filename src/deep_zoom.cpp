@@ -0,0 +1,152 @@
+#include "deep_zoom.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <sys/stat.h>
+
+using namespace cv;
+using namespace std;
+
+const int DeepZoomPyramid::tileSize;
+const size_t DeepZoomPyramid::maxSumLevel;
+
+DeepZoomPyramid::DeepZoomPyramid(const Mat& image, const string& path) :
+	image_(image),
+	path_(path)
+{
+	// Down to a single pixel, Deep Zoom numbers the levels the other way round.
+	int numLevels = 1;
+	while ((1 << (numLevels - 1)) < max(image.cols, image.rows))
+		++numLevels;
+	levels_.resize(numLevels);
+	mkdir((path_ + "_files").c_str(), 0755);
+	for (int k = 0; k < numLevels; ++k)
+	{
+		Level& level = levels_[k];
+		level.size = Size((image.cols + (1 << k) - 1) >> k, (image.rows + (1 << k) - 1) >> k);
+		if (k && static_cast<size_t>(k) <= maxSumLevel)
+			level.sums = Mat(level.size, CV_32SC4, Scalar_<int>(0));
+		level.tilesX = (level.size.width + tileSize - 1) / tileSize;
+		int tilesY = (level.size.height + tileSize - 1) / tileSize;
+		level.dirty.assign(level.tilesX * tilesY, 0);
+		stringstream dir;
+		dir << path_ << "_files/" << numLevels - 1 - k;
+		mkdir(dir.str().c_str(), 0755);
+	}
+
+	ofstream dzi(path_ + ".dzi");
+	dzi << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << endl
+		<< "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\""
+		<< " Format=\"png\" Overlap=\"0\" TileSize=\"" << tileSize << "\">" << endl
+		<< "  <Size Width=\"" << image.cols << "\" Height=\"" << image.rows << "\"/>" << endl
+		<< "</Image>" << endl;
+	if (!dzi)
+		cout << "Could not write " << path_ << ".dzi" << endl;
+}
+
+void DeepZoomPyramid::MarkDirty(size_t k, PosComponent x, PosComponent y)
+{
+	Level& level = levels_[k];
+	int tile = (y / tileSize) * level.tilesX + x / tileSize;
+	if (level.dirty[tile])
+		return;
+	level.dirty[tile] = 1;
+	level.dirtyTiles.push_back(tile);
+}
+
+void DeepZoomPyramid::Placed(const Pos& pos, const Color& color)
+{
+	MarkDirty(0, pos.first, pos.second);
+	for (size_t k = 1; k < levels_.size(); ++k)
+	{
+		PosComponent x = pos.first >> k;
+		PosComponent y = pos.second >> k;
+		if (k <= maxSumLevel)
+		{
+			Vec4i& texel = levels_[k].sums.at<Vec4i>(y, x);
+			for (int c = 0; c < 3; ++c)
+				texel[c] += color[c];
+			texel[3] += 1;
+		}
+		MarkDirty(k, x, y);
+	}
+}
+
+void DeepZoomPyramid::Replaced(const Pos& pos, const Color& oldColor, const Color& color)
+{
+	MarkDirty(0, pos.first, pos.second);
+	for (size_t k = 1; k < levels_.size(); ++k)
+	{
+		PosComponent x = pos.first >> k;
+		PosComponent y = pos.second >> k;
+		if (k <= maxSumLevel)
+		{
+			Vec4i& texel = levels_[k].sums.at<Vec4i>(y, x);
+			for (int c = 0; c < 3; ++c)
+				texel[c] += color[c] - oldColor[c];
+		}
+		MarkDirty(k, x, y);
+	}
+}
+
+Mat DeepZoomPyramid::RenderTile(size_t k, int tileX, int tileY) const
+{
+	const Size& size = levels_[k].size;
+	int x0 = tileX * tileSize;
+	int y0 = tileY * tileSize;
+	Mat tile(min(tileSize, size.height - y0), min(tileSize, size.width - x0), ImageType,
+			 Scalar_<Channel>(invalidColor));
+	// Sums of the coarse levels are added up from the deepest stored one.
+	size_t sumLevel = min(k, maxSumLevel);
+	const Mat& sums = levels_[sumLevel].sums;
+	int shift = static_cast<int>(k - sumLevel);
+	for (int y = 0; y < tile.rows; ++y)
+	{
+		for (int x = 0; x < tile.cols; ++x)
+		{
+			if (!k)
+			{
+				tile.at<Color>(y, x) = GetPixel(image_, x0 + x, y0 + y);
+				continue;
+			}
+			int64_t texel[4] = {0, 0, 0, 0};
+			int sx0 = (x0 + x) << shift;
+			int sy0 = (y0 + y) << shift;
+			int sx1 = min(sx0 + (1 << shift), sums.cols);
+			int sy1 = min(sy0 + (1 << shift), sums.rows);
+			for (int sy = sy0; sy < sy1; ++sy)
+				for (int sx = sx0; sx < sx1; ++sx)
+					for (int c = 0; c < 4; ++c)
+						texel[c] += sums.at<Vec4i>(sy, sx)[c];
+			if (!texel[3])
+				continue;
+			Color& mean = tile.at<Color>(y, x);
+			for (int c = 0; c < 3; ++c)
+				mean[c] = static_cast<Channel>((texel[c] + texel[3] / 2) / texel[3]);
+		}
+	}
+	return tile;
+}
+
+void DeepZoomPyramid::Export()
+{
+	for (size_t k = 0; k < levels_.size(); ++k)
+	{
+		Level& level = levels_[k];
+		for (int tile : level.dirtyTiles)
+		{
+			int tileX = tile % level.tilesX;
+			int tileY = tile / level.tilesX;
+			stringstream ss;
+			ss << path_ << "_files/" << levels_.size() - 1 - k << "/"
+				<< tileX << "_" << tileY << ".png";
+			imwrite(ss.str(), RenderTile(k, tileX, tileY));
+			level.dirty[tile] = 0;
+		}
+		level.dirtyTiles.clear();
+	}
+}
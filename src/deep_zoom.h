@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common.h"
+#include "output.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Mip pyramid of the canvas, updated with every placement in O(levels),
+// and exported as Deep Zoom (DZI) tiles. A texel holds the mean of the
+// filled pixels below it. Only the tiles changed since the last export
+// are written, so a viewer can follow the run live.
+class DeepZoomPyramid : public PlacementListener
+{
+public:
+	// Writes path.dzi, the tiles go to path_files/<level>/<col>_<row>.png.
+	DeepZoomPyramid(const cv::Mat& image, const std::string& path);
+	void Placed(const Pos& pos, const Color& color) override;
+	void Replaced(const Pos& pos, const Color& oldColor, const Color& color) override;
+	void Snapshot(const cv::Mat&, const cv::Mat&) override { Export(); }
+	void Export();
+private:
+	static const int tileSize = 256;
+	// Deepest level with stored sums, 255 * 4^11 still fits an int.
+	// The coarser levels are summed from it when their tiles are rendered.
+	static const std::size_t maxSumLevel = 11;
+	struct Level
+	{
+		cv::Size size;
+		cv::Mat sums; // Summed colors and count of filled pixels, CV_32SC4.
+		int tilesX;
+		std::vector<unsigned char> dirty;
+		std::vector<int> dirtyTiles;
+	};
+	void MarkDirty(std::size_t k, PosComponent x, PosComponent y);
+	cv::Mat RenderTile(std::size_t k, int tileX, int tileY) const;
+	const cv::Mat& image_;
+	std::string path_;
+	std::vector<Level> levels_; // levels_[k] is 2^k times smaller than image_.
+};
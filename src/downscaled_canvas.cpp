@@ -0,0 +1,44 @@
+#include "downscaled_canvas.h"
+
+#include <cassert>
+
+using namespace cv;
+using namespace std;
+
+DownscaledCanvas::DownscaledCanvas(Size canvasSize, int scale) :
+	scale_(scale),
+	sums_((canvasSize.height + scale - 1) / scale, (canvasSize.width + scale - 1) / scale,
+		  CV_32SC4, Scalar_<int>(0)),
+	frame_(sums_.size(), ImageType, Scalar_<Channel>(invalidColor))
+{
+	assert(scale <= maxPreviewScale);
+}
+
+void DownscaledCanvas::Placed(const Pos& pos, const Color& color)
+{
+	PosComponent x = pos.first / scale_;
+	PosComponent y = pos.second / scale_;
+	Vec4i& texel = sums_.at<Vec4i>(y, x);
+	for (int c = 0; c < 3; ++c)
+		texel[c] += color[c];
+	texel[3] += 1;
+	UpdateMean(x, y);
+}
+
+void DownscaledCanvas::Replaced(const Pos& pos, const Color& oldColor, const Color& color)
+{
+	PosComponent x = pos.first / scale_;
+	PosComponent y = pos.second / scale_;
+	Vec4i& texel = sums_.at<Vec4i>(y, x);
+	for (int c = 0; c < 3; ++c)
+		texel[c] += color[c] - oldColor[c];
+	UpdateMean(x, y);
+}
+
+void DownscaledCanvas::UpdateMean(PosComponent x, PosComponent y)
+{
+	const Vec4i& texel = sums_.at<Vec4i>(y, x);
+	Color& mean = frame_.at<Color>(y, x);
+	for (int c = 0; c < 3; ++c)
+		mean[c] = static_cast<Channel>((texel[c] + texel[3] / 2) / texel[3]);
+}
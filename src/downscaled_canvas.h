@@ -0,0 +1,21 @@
+#pragma once
+
+#include "common.h"
+#include "options.h"
+
+// The canvas downscaled by an integer factor. A texel holds the mean of
+// the filled pixels below it and is updated with every placement in O(1).
+// The sums are ints, which limits the factor to maxPreviewScale.
+class DownscaledCanvas
+{
+public:
+	DownscaledCanvas(cv::Size canvasSize, int scale);
+	void Placed(const Pos& pos, const Color& color);
+	void Replaced(const Pos& pos, const Color& oldColor, const Color& color);
+	const cv::Mat& Frame() const { return frame_; }
+private:
+	int scale_;
+	void UpdateMean(PosComponent x, PosComponent y);
+	cv::Mat sums_; // Summed colors and count of filled pixels, CV_32SC4.
+	cv::Mat frame_;
+};
@@ -0,0 +1,122 @@
+#include "frame_ring.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+
+FrameRing::FrameRing(const string& name, Size size, uint32_t numSlots,
+					 FrameRingPolicy policy, bool raw) :
+	name_(name),
+	raw_(raw),
+	size_(0),
+	header_(nullptr),
+	placements_(0)
+{
+	FrameRingHeader layout;
+	layout.width = size.width;
+	layout.height = size.height;
+	layout.numSlots = numSlots;
+	size_ = FrameRingSize(layout);
+
+	shm_unlink(name_.c_str());
+	int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0 || ftruncate(fd, static_cast<off_t>(size_)))
+	{
+		cout << "Could not create shared memory " << name_ << endl;
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	void* data = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		cout << "Could not map shared memory " << name_ << endl;
+		return;
+	}
+	// The fresh memory is zeroed, which is a valid state for the atomics.
+	header_ = static_cast<FrameRingHeader*>(data);
+	header_->width = layout.width;
+	header_->height = layout.height;
+	header_->numSlots = numSlots;
+	header_->policy = policy;
+	header_->magic.store(frameRingMagic, memory_order_release);
+	cout << "Frame ring: " << name_ << ", " << size.width << "x" << size.height
+		<< ", " << numSlots << " slots" << endl;
+}
+
+FrameRing::~FrameRing()
+{
+	if (!header_)
+		return;
+	header_->finished.store(1, memory_order_release);
+	munmap(header_, size_);
+	// Readers keep their mappings, but no new one can attach.
+	shm_unlink(name_.c_str());
+}
+
+void FrameRing::Snapshot(const Mat& image, const Mat& embellished)
+{
+	const Mat& frame = raw_ ? image : embellished;
+	if (header_ && frame.cols == static_cast<int>(header_->width)
+		&& frame.rows == static_cast<int>(header_->height))
+		Publish(frame);
+}
+
+void FrameRing::Publish(const Mat& frame)
+{
+	uint64_t n = header_->published.load(memory_order_relaxed);
+	if (header_->policy == FrameRingPolicy::Block && n >= header_->numSlots)
+	{
+		// The slot still holds frame n - numSlots, wait for its readers.
+		// Readers that are gone or stuck are dropped.
+		auto start = chrono::steady_clock::now();
+		auto busy = [&]() -> bool
+		{
+			bool stale = chrono::steady_clock::now() - start > chrono::seconds(frameRingStaleSeconds);
+			bool result = false;
+			for (FrameRingConsumer& consumer : header_->consumers)
+			{
+				if (consumer.state.load(memory_order_acquire) != 2
+					|| consumer.next.load(memory_order_acquire) + header_->numSlots > n)
+					continue;
+				pid_t pid = consumer.pid.load(memory_order_relaxed);
+				bool gone = kill(pid, 0) && errno == ESRCH;
+				if (stale || gone)
+				{
+					// A living reader frees its slot itself once it notices.
+					uint32_t active = 2;
+					if (consumer.state.compare_exchange_strong(active, gone ? 0 : 3))
+						cout << "Frame ring: dropped reader " << pid << endl;
+					continue;
+				}
+				result = true;
+			}
+			return result;
+		};
+		while (busy())
+			this_thread::sleep_for(chrono::microseconds(200));
+	}
+
+	FrameRingSlot& slot = FrameRingSlots(header_)[n % header_->numSlots];
+	slot.sequence.store(2 * n + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	slot.frameNumber = n;
+	slot.placements = placements_;
+	unsigned char* data = FrameRingFrame(header_, n);
+	size_t rowBytes = frame.cols * 3;
+	for (int y = 0; y < frame.rows; ++y)
+		memcpy(data + y * rowBytes, frame.ptr<Channel>(y), rowBytes);
+	slot.sequence.store(2 * n + 2, memory_order_release);
+	header_->published.store(n + 1, memory_order_release);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "common.h"
+#include "frame_ring_layout.h"
+#include "output.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Publishes every snapshot (embellished or raw) into a POSIX shared memory
+// ring (see frame_ring_layout.h), so encoders and analytics on the same
+// host can read the frames without going through image files.
+// Snapshots of another size than the canvas (e.g. coarse levels) are skipped.
+class FrameRing : public PlacementListener
+{
+public:
+	FrameRing(const std::string& name, cv::Size size, std::uint32_t numSlots,
+			  FrameRingPolicy policy, bool raw);
+	~FrameRing();
+	FrameRing(const FrameRing&) = delete;
+	FrameRing& operator=(const FrameRing&) = delete;
+	bool Valid() const { return header_ != nullptr; }
+	void Placed(const Pos&, const Color&) override { ++placements_; }
+	void Replaced(const Pos&, const Color&, const Color&) override {}
+	void Snapshot(const cv::Mat& image, const cv::Mat& embellished) override;
+private:
+	void Publish(const cv::Mat& frame);
+	std::string name_;
+	bool raw_;
+	std::size_t size_;
+	FrameRingHeader* header_;
+	std::uint64_t placements_;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+// Shared memory layout of the frame ring, also used by the external
+// readers (see tools/ring2y4m.cpp), so this header does not need OpenCV.
+//
+// One producer publishes frame n into slot n % numSlots. Every slot is
+// guarded by a sequence counter (seqlock): odd while the producer writes
+// it, 2 * (n + 1) once frame n is complete. A reader copies or processes
+// the frame in place and checks the counter again afterwards to detect
+// that it was overwritten meanwhile.
+//
+// With FrameRingPolicy::Block, a registered reader whose process is gone,
+// or that makes no progress for frameRingStaleSeconds, is dropped by the
+// producer, so a crashed reader cannot stall the run. The slot of a
+// dropped reader that is still alive stays taken until the reader sees
+// the drop or its process is gone, so its late cursor updates can never
+// land in the slot of another reader.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+const std::uint32_t frameRingMagic = 0x41434652; // "RFCA"
+const int maxFrameRingConsumers = 8;
+const int frameRingStaleSeconds = 10;
+
+enum class FrameRingPolicy : std::uint32_t
+{
+	Drop, // Overwrite the oldest frame, slow readers skip frames.
+	Block // Wait until every registered reader is done with the slot.
+};
+
+struct FrameRingConsumer
+{
+	// 0 free, 1 registering, 2 active, 3 dropped while still alive.
+	std::atomic<std::uint32_t> state;
+	// Number of the next frame the reader wants, i.e. all below are done.
+	std::atomic<std::uint64_t> next;
+	// Process id of the reader, set before it becomes active.
+	std::atomic<std::int32_t> pid;
+};
+
+struct FrameRingSlot
+{
+	std::atomic<std::uint64_t> sequence;
+	std::uint64_t frameNumber;
+	std::uint64_t placements; // Colors placed when the frame was taken.
+	char padding[40];
+};
+
+struct FrameRingHeader
+{
+	std::atomic<std::uint32_t> magic; // Set once everything else is valid.
+	std::uint32_t width; // BGR frames, 3 bytes per pixel, no row padding.
+	std::uint32_t height;
+	std::uint32_t numSlots;
+	FrameRingPolicy policy;
+	std::atomic<std::uint32_t> finished; // No further frames will come.
+	std::atomic<std::uint64_t> published; // Number of complete frames.
+	FrameRingConsumer consumers[maxFrameRingConsumers];
+};
+
+inline std::size_t FrameRingFrameBytes(const FrameRingHeader& header)
+{
+	// Page aligned, so the frames can be mapped or processed separately.
+	std::size_t bytes = std::size_t(header.width) * header.height * 3;
+	return (bytes + 4095) / 4096 * 4096;
+}
+
+inline std::size_t FrameRingDataOffset(std::uint32_t numSlots)
+{
+	std::size_t bytes = sizeof(FrameRingHeader) + numSlots * sizeof(FrameRingSlot);
+	return (bytes + 4095) / 4096 * 4096;
+}
+
+inline std::size_t FrameRingSize(const FrameRingHeader& header)
+{
+	return FrameRingDataOffset(header.numSlots) + header.numSlots * FrameRingFrameBytes(header);
+}
+
+inline FrameRingSlot* FrameRingSlots(FrameRingHeader* header)
+{
+	return reinterpret_cast<FrameRingSlot*>(header + 1);
+}
+
+inline unsigned char* FrameRingFrame(FrameRingHeader* header, std::uint64_t frameNumber)
+{
+	return reinterpret_cast<unsigned char*>(header) + FrameRingDataOffset(header->numSlots)
+		+ (frameNumber % header->numSlots) * FrameRingFrameBytes(*header);
+}
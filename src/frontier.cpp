@@ -0,0 +1,39 @@
+#include "frontier.h"
+#include "parallel.h"
+
+#include <cassert>
+
+using namespace cv;
+using namespace std;
+
+Frontier::Frontier(cv::Size size) :
+	slots_(FirstTouchMat(size, CV_32SC1, Scalar(-1))),
+	size_(0)
+{
+	size_t numPartitions = NumThreads();
+	partitions_.reserve(numPartitions);
+	for (size_t part = 0; part < numPartitions; ++part)
+		partitions_.emplace_back(NodeAllocator<Pos>(WorkerNode(part)));
+}
+
+void Frontier::Insert(const Pos& pos)
+{
+	int& slot = slots_.at<int>(pos.second, pos.first);
+	if (slot >= 0)
+		return;
+	slot = static_cast<int>(size_);
+	partitions_[size_ % partitions_.size()].push_back(pos);
+	++size_;
+}
+
+void Frontier::Erase(const Pos& pos)
+{
+	int& slot = slots_.at<int>(pos.second, pos.first);
+	assert(slot >= 0);
+	const Pos& moved = At(size_ - 1);
+	slots_.at<int>(moved.second, moved.first) = slot;
+	At(static_cast<size_t>(slot)) = moved;
+	--size_;
+	partitions_[size_ % partitions_.size()].pop_back();
+	slot = -1;
+}
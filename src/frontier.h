@@ -0,0 +1,74 @@
+#pragma once
+
+#include "common.h"
+#include "numa.h"
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+// The open border positions, stored contiguously for fast scans
+// and random access. A per pixel slot map makes insert, erase
+// and lookup O(1). Erasing moves the last position into the gap.
+//
+// The positions are interleaved over one partition per worker thread:
+// index i lives in partition i % NumPartitions(), which is allocated on
+// the node of worker i % NumPartitions(). So ParallelFor over the
+// partitions scans node-local memory, while the order of the indices
+// does not depend on the number of partitions.
+class Frontier
+{
+public:
+	typedef std::vector<Pos, NodeAllocator<Pos>> Partition;
+	class const_iterator
+	{
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef Pos value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const Pos* pointer;
+		typedef const Pos& reference;
+		const_iterator(const Frontier& frontier, std::size_t idx) : frontier_(&frontier), idx_(idx) {}
+		const Pos& operator*() const { return (*frontier_)[idx_]; }
+		const Pos* operator->() const { return &(*frontier_)[idx_]; }
+		const_iterator& operator++() { ++idx_; return *this; }
+		const_iterator operator++(int) { const_iterator it = *this; ++idx_; return it; }
+		bool operator==(const const_iterator& other) const { return idx_ == other.idx_; }
+		bool operator!=(const const_iterator& other) const { return idx_ != other.idx_; }
+	private:
+		const Frontier* frontier_;
+		std::size_t idx_;
+	};
+	explicit Frontier(cv::Size size);
+	bool Empty() const { return size_ == 0; }
+	std::size_t Size() const { return size_; }
+	bool Contains(const Pos& pos) const
+	{
+		return slots_.at<int>(pos.second, pos.first) >= 0;
+	}
+	// Index of a contained position, changes when others are erased.
+	std::size_t IndexOf(const Pos& pos) const
+	{
+		return static_cast<std::size_t>(slots_.at<int>(pos.second, pos.first));
+	}
+	const Pos& operator[](std::size_t idx) const
+	{
+		return partitions_[idx % partitions_.size()][idx / partitions_.size()];
+	}
+	const_iterator begin() const { return const_iterator(*this, 0); }
+	const_iterator end() const { return const_iterator(*this, size_); }
+	std::size_t NumPartitions() const { return partitions_.size(); }
+	// The positions with an index i % NumPartitions() == part, by index.
+	const Partition& GetPartition(std::size_t part) const { return partitions_[part]; }
+	// Does nothing if pos is already contained.
+	void Insert(const Pos& pos);
+	void Erase(const Pos& pos);
+private:
+	Pos& At(std::size_t idx)
+	{
+		return partitions_[idx % partitions_.size()][idx / partitions_.size()];
+	}
+	cv::Mat slots_; // Index of the position, -1 if not contained.
+	std::vector<Partition> partitions_;
+	std::size_t size_;
+};
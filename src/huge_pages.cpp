@@ -0,0 +1,94 @@
+#include "huge_pages.h"
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <sys/mman.h>
+
+using namespace std;
+
+namespace
+{
+
+atomic<bool> enabled(true);
+
+size_t RoundUp(size_t bytes)
+{
+	return (bytes + hugePageSize - 1) / hugePageSize * hugePageSize;
+}
+
+void* MapAnonymous(size_t bytes, int flags)
+{
+	void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+					  MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+	return data == MAP_FAILED ? nullptr : data;
+}
+
+}
+
+void SetHugePagesEnabled(bool enable)
+{
+	enabled = enable;
+}
+
+bool HugePagesEnabled()
+{
+	return enabled;
+}
+
+void* AllocateLarge(size_t bytes)
+{
+	if (bytes < hugePageSize)
+		return ::operator new(bytes);
+	size_t size = RoundUp(bytes);
+#ifdef MAP_HUGETLB
+	if (enabled)
+		if (void* data = MapAnonymous(size, MAP_HUGETLB))
+			return data;
+#endif
+	// Map one huge page more and trim it, so the block starts on a
+	// huge page boundary and is fully coverable by huge pages.
+	char* raw = static_cast<char*>(MapAnonymous(size + hugePageSize, 0));
+	if (!raw)
+		throw bad_alloc();
+	uintptr_t address = reinterpret_cast<uintptr_t>(raw);
+	char* data = raw + (RoundUp(address) - address);
+	if (data != raw)
+		munmap(raw, static_cast<size_t>(data - raw));
+	munmap(data + size, static_cast<size_t>(raw + size + hugePageSize - (data + size)));
+	madvise(data, size, enabled ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+	return data;
+}
+
+void FreeLarge(void* data, size_t bytes)
+{
+	if (bytes < hugePageSize)
+		::operator delete(data);
+	else
+		munmap(data, RoundUp(bytes));
+}
+
+void AdviseHugePages(void* data, size_t bytes)
+{
+	uintptr_t begin = RoundUp(reinterpret_cast<uintptr_t>(data));
+	uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) / hugePageSize * hugePageSize;
+	if (begin < end)
+		madvise(reinterpret_cast<void*>(begin), end - begin,
+				enabled ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+}
+
+size_t AnonHugePageBytes()
+{
+	ifstream file("/proc/self/smaps_rollup");
+	string name;
+	size_t kiloBytes = 0;
+	while (file >> name)
+	{
+		if (name == "AnonHugePages:" && file >> kiloBytes)
+			return kiloBytes * 1024;
+		file.ignore(numeric_limits<streamsize>::max(), '\n');
+	}
+	return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+const std::size_t hugePageSize = std::size_t(2) << 20;
+
+// On by default, off (--huge-pages=off) for comparisons.
+void SetHugePagesEnabled(bool enabled);
+bool HugePagesEnabled();
+
+// Memory for large, randomly accessed arrays. Blocks of at least one huge
+// page come from explicit huge pages (MAP_HUGETLB) if the system reserved
+// some, else from anonymous memory aligned to 2 MB and advised for
+// transparent huge pages. Smaller blocks come from operator new.
+// Falls back silently, throws std::bad_alloc only if no memory is left.
+void* AllocateLarge(std::size_t bytes);
+void FreeLarge(void* data, std::size_t bytes);
+
+// Asks for transparent huge pages for the 2 MB aligned part of memory
+// that was not written yet, e.g. a freshly allocated cv::Mat.
+void AdviseHugePages(void* data, std::size_t bytes);
+
+// Resident memory of this process in transparent huge pages,
+// from /proc/self/smaps_rollup.
+std::size_t AnonHugePageBytes();
+
+// std allocator on top of AllocateLarge.
+template<class T>
+class HugePageAllocator
+{
+public:
+	typedef T value_type;
+	HugePageAllocator() {}
+	template<class U> HugePageAllocator(const HugePageAllocator<U>&) {}
+	T* allocate(std::size_t n)
+	{
+		if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+			throw std::bad_alloc();
+		return static_cast<T*>(AllocateLarge(n * sizeof(T)));
+	}
+	void deallocate(T* data, std::size_t n)
+	{
+		FreeLarge(data, n * sizeof(T));
+	}
+};
+
+template<class T, class U>
+bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return true; }
+
+template<class T, class U>
+bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return false; }
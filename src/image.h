@@ -0,0 +1,9 @@
+#pragma once
+
+// The image types and I/O: OpenCV, or the built-in subset
+// if it is built without OpenCV (scons opencv=no).
+#ifdef ALLCOLORS_NO_OPENCV
+#include "lite_image.h"
+#else
+#include <opencv2/opencv.hpp>
+#endif
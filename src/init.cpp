@@ -0,0 +1,156 @@
+#include "init.h"
+#include "numa.h"
+#include "symmetry.h"
+
+#include <iostream>
+#include <limits>
+
+using namespace cv;
+using namespace std;
+
+set<Pos> NonBlackPositions(const Mat& img)
+{
+	set<Pos> result;
+	for (int y = 0; y < img.rows; ++y)
+		for (int x = 0; x < img.cols; ++x)
+			if (img.at<unsigned char>(y, x) > 0)
+				result.insert(Pos(x,y));
+	return result;
+}
+
+namespace
+{
+
+Mat LoadImage(const string& path, int flags)
+{
+	Mat result = imread(path, flags);
+	if (!result.rows)
+		cout << "Could not load " << path << endl;
+	return result;
+}
+
+}
+
+int NumSeedPoints(const string& source)
+{
+	if (source == "2") return 2;
+	if (source == "3") return 3;
+	if (source == "4") return 4;
+	return 0;
+}
+
+vector<pair<double, double>> SeedPoints(int num)
+{
+	vector<pair<double, double>> points;
+	if (num == 2)
+	{
+		points.push_back(make_pair(0.33, 0.5));
+		points.push_back(make_pair(0.67, 0.5));
+	}
+	else if (num == 3)
+	{
+		points.push_back(make_pair(0.33, 0.4));
+		points.push_back(make_pair(0.67, 0.4));
+		points.push_back(make_pair(0.50, 0.69));
+	}
+	else if (num == 4)
+	{
+		points.push_back(make_pair(0.33, 0.36));
+		points.push_back(make_pair(0.67, 0.36));
+		points.push_back(make_pair(0.36, 0.64));
+		points.push_back(make_pair(0.64, 0.64));
+	}
+	return points;
+}
+
+Setup Init(const Options& options)
+{
+	Setup setup;
+	if (!options.target.empty())
+	{
+		setup.target = LoadImage(options.target, IMREAD_COLOR);
+		if (!setup.target.rows)
+			return Setup();
+	}
+
+	int num = NumSeedPoints(options.source);
+
+	if (!num)
+	{
+		Mat src = LoadImage(options.source, IMREAD_GRAYSCALE);
+		if (!src.rows)
+			return Setup();
+		if (setup.target.rows && setup.target.size() != src.size())
+		{
+			cout << "Target and seed image sizes differ." << endl;
+			return Setup();
+		}
+		if (NeedsSquareCanvas(options.symmetry) && src.rows != src.cols)
+		{
+			cout << "This symmetry needs a square seed image." << endl;
+			return Setup();
+		}
+		setup.image = FirstTouchMat(src.size(), ImageType, Scalar(invalidColor));
+		setup.nextPositions = NonBlackPositions(src);
+		return setup;
+	}
+
+	// The canvas takes the size of the target image, if there is one.
+	Size size = setup.target.rows ? setup.target.size() : Size(options.width, options.height);
+	if (NeedsSquareCanvas(options.symmetry))
+	{
+		if (setup.target.rows && setup.target.rows != setup.target.cols)
+		{
+			cout << "This symmetry needs a square target image." << endl;
+			return Setup();
+		}
+		size.width = size.height = min(size.width, size.height);
+	}
+	Mat image = FirstTouchMat(size, ImageType, Scalar(invalidColor));
+	for (const pair<double, double>& point : SeedPoints(num))
+	{
+		PosComponent plusLength = 5;
+		PosComponent x = point.first*image.cols;
+		PosComponent y = point.second*image.rows;
+		set<Pos> plus;
+		for (PosComponent nx = x-plusLength; nx <= x+plusLength; ++nx)
+			if (IsInside(image, nx, y))
+				plus.insert(Pos(nx, y));
+		for (PosComponent ny = y-plusLength; ny <= y+plusLength; ++ny)
+			if (IsInside(image, x, ny))
+				plus.insert(Pos(x, ny));
+		setup.nextPositions.insert(plus.begin(), plus.end());
+		setup.seedFronts.push_back(plus);
+	}
+	setup.image = image;
+	return setup;
+}
+
+vector<Color> CreatePalette(mt19937& g, size_t maxColors)
+{
+	vector<Color> colors;
+	int colValues = 64;
+	int colMult = 4;
+	for(int b = 1; b < colValues; ++b)
+		for(int g = 1; g < 2*colValues; ++g)
+			for(int r = 1; r < 2*colValues; ++r)
+				colors.push_back(Color(colMult*b, colMult*g/2, colMult*r/2));
+
+	shuffle(colors.begin(), colors.end(), g);
+	if (colors.size() > maxColors)
+		colors.resize(maxColors);
+	SortByHue(colors);
+	return colors;
+}
+
+ColorRuns CreatePalette(const Options& options, mt19937& g, size_t maxColors)
+{
+	if (!options.palette.empty())
+		return PaletteFromImage(options.palette, g, maxColors);
+	// Only a target needs a palette sampled evenly from the whole cube.
+	// Otherwise the colors are taken from the back of the hue sorted cube
+	// until the canvas is full, as always.
+	if (options.target.empty())
+		maxColors = numeric_limits<size_t>::max();
+	return ColorRuns(CreatePalette(g, maxColors));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common.h"
+#include "options.h"
+#include "palette.h"
+
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+std::set<Pos> NonBlackPositions(const cv::Mat& img);
+
+// Number of fixed seed points for the source "2", "3" or "4", else 0.
+int NumSeedPoints(const std::string& source);
+
+// Fixed seed points relative to the canvas size.
+std::vector<std::pair<double, double>> SeedPoints(int num);
+
+struct Setup
+{
+	cv::Mat image; // The empty canvas.
+	std::set<Pos> nextPositions; // The initial frontier.
+	// The initial frontier per fixed seed point, empty for seed images.
+	std::vector<std::set<Pos>> seedFronts;
+	cv::Mat target; // Optional image to approximate, same size as image.
+};
+
+// The canvas is empty (no rows) if an input image could not be loaded.
+Setup Init(const Options& options);
+
+// All colors of the (reduced) RGB cube, shuffled and sorted by hue.
+// If there are more colors than maxColors, a random subset is kept.
+std::vector<Color> CreatePalette(std::mt19937& g, std::size_t maxColors);
+
+// The colors of the palette image options.palette, at most maxColors of
+// them, or else the cube palette, thinned to maxColors only for a target.
+// Empty if the image could not be loaded.
+ColorRuns CreatePalette(const Options& options, std::mt19937& g, std::size_t maxColors);
@@ -0,0 +1,346 @@
+#ifdef ALLCOLORS_NO_OPENCV
+
+#include "lite_image.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <zlib.h>
+
+using namespace std;
+
+namespace cv
+{
+
+namespace
+{
+
+const int depthSizes[] = {1, 1, 2, 2, 4, 4, 8};
+
+const unsigned char pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+bool EndsWith(const string& str, const string& suffix)
+{
+	if (str.size() < suffix.size())
+		return false;
+	return equal(suffix.rbegin(), suffix.rend(), str.rbegin(), [](char c1, char c2)
+	{
+		return tolower(c1) == tolower(c2);
+	});
+}
+
+// Converts interleaved RGB, RGBA, gray or gray+alpha pixels
+// into a BGR or gray image.
+Mat FromInterleaved(const unsigned char* pixels, int width, int height,
+					int channels, int flags)
+{
+	Mat image(height, width, flags == IMREAD_GRAYSCALE ? CV_8UC1 : CV_8UC3);
+	for (int y = 0; y < height; ++y)
+	{
+		const unsigned char* src = pixels + static_cast<size_t>(y) * width * channels;
+		unsigned char* dst = image.ptr(y);
+		for (int x = 0; x < width; ++x, src += channels)
+		{
+			unsigned char r = src[0];
+			unsigned char g = channels >= 3 ? src[1] : src[0];
+			unsigned char b = channels >= 3 ? src[2] : src[0];
+			if (flags == IMREAD_GRAYSCALE)
+				*dst++ = static_cast<unsigned char>((r * 4899 + g * 9617 + b * 1868 + 8192) >> 14);
+			else
+			{
+				*dst++ = b;
+				*dst++ = g;
+				*dst++ = r;
+			}
+		}
+	}
+	return image;
+}
+
+// Binary PPM (P6) or PGM (P5) with 8 bit samples.
+Mat ReadPnm(ifstream& file, int flags)
+{
+	string magic;
+	file >> magic;
+	int values[3] = {0, 0, 0};
+	for (int& value : values)
+	{
+		// Skip comments.
+		while (file >> ws && file.peek() == '#')
+			file.ignore(numeric_limits<streamsize>::max(), '\n');
+		file >> value;
+	}
+	file.get();
+	int width = values[0], height = values[1], maxValue = values[2];
+	if (!file || (magic != "P5" && magic != "P6") || width <= 0 || height <= 0
+		|| maxValue <= 0 || maxValue > 255)
+		return Mat();
+	int channels = magic == "P6" ? 3 : 1;
+	vector<unsigned char> pixels(static_cast<size_t>(width) * height * channels);
+	if (!file.read(reinterpret_cast<char*>(pixels.data()), static_cast<streamsize>(pixels.size())))
+		return Mat();
+	return FromInterleaved(pixels.data(), width, height, channels, flags);
+}
+
+uint32_t ReadBigEndian(const unsigned char* bytes)
+{
+	return static_cast<uint32_t>(bytes[0]) << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3];
+}
+
+unsigned char Paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc)
+		return static_cast<unsigned char>(a);
+	return static_cast<unsigned char>(pb <= pc ? b : c);
+}
+
+// 8 bit gray, gray+alpha, RGB or RGBA, not interlaced.
+Mat ReadPng(ifstream& file, int flags)
+{
+	unsigned char signature[8];
+	if (!file.read(reinterpret_cast<char*>(signature), 8) || !equal(signature, signature + 8, pngSignature))
+		return Mat();
+	int width = 0, height = 0, channels = 0;
+	vector<unsigned char> compressed;
+	for (;;)
+	{
+		unsigned char header[8];
+		if (!file.read(reinterpret_cast<char*>(header), 8))
+			return Mat();
+		uint32_t length = ReadBigEndian(header);
+		string type(header + 4, header + 8);
+		vector<unsigned char> chunk(length);
+		if (!file.read(reinterpret_cast<char*>(chunk.data()), length) || !file.ignore(4))
+			return Mat();
+		if (type == "IHDR" && length >= 13)
+		{
+			width = static_cast<int>(ReadBigEndian(&chunk[0]));
+			height = static_cast<int>(ReadBigEndian(&chunk[4]));
+			int bitDepth = chunk[8], colorType = chunk[9], interlace = chunk[12];
+			channels = colorType == 0 ? 1 : colorType == 2 ? 3 : colorType == 4 ? 2
+				: colorType == 6 ? 4 : 0;
+			if (bitDepth != 8 || !channels || interlace)
+			{
+				cout << "Unsupported PNG format, only 8 bit, not interlaced "
+					"gray or RGB(A) images can be read without OpenCV." << endl;
+				return Mat();
+			}
+		}
+		else if (type == "IDAT")
+			compressed.insert(compressed.end(), chunk.begin(), chunk.end());
+		else if (type == "IEND")
+			break;
+	}
+	if (width <= 0 || height <= 0)
+		return Mat();
+
+	size_t rowBytes = static_cast<size_t>(width) * channels;
+	vector<unsigned char> raw(height * (rowBytes + 1));
+	uLongf rawSize = static_cast<uLongf>(raw.size());
+	if (uncompress(raw.data(), &rawSize, compressed.data(),
+				   static_cast<uLong>(compressed.size())) != Z_OK || rawSize != raw.size())
+		return Mat();
+
+	// Undo the per row filters in place.
+	vector<unsigned char> pixels(height * rowBytes);
+	for (int y = 0; y < height; ++y)
+	{
+		unsigned char filter = raw[y * (rowBytes + 1)];
+		const unsigned char* src = &raw[y * (rowBytes + 1) + 1];
+		unsigned char* row = &pixels[y * rowBytes];
+		const unsigned char* up = y ? row - rowBytes : nullptr;
+		for (size_t i = 0; i < rowBytes; ++i)
+		{
+			int a = i >= static_cast<size_t>(channels) ? row[i - channels] : 0;
+			int b = up ? up[i] : 0;
+			int c = up && i >= static_cast<size_t>(channels) ? up[i - channels] : 0;
+			int predicted = filter == 1 ? a : filter == 2 ? b : filter == 3 ? (a + b) / 2
+				: filter == 4 ? Paeth(a, b, c) : 0;
+			row[i] = static_cast<unsigned char>(src[i] + predicted);
+		}
+	}
+	return FromInterleaved(pixels.data(), width, height, channels, flags);
+}
+
+bool WritePnm(const string& path, const Mat& image)
+{
+	ofstream file(path, ios::binary);
+	int channels = image.channels();
+	file << (channels == 1 ? "P5" : "P6") << "\n" << image.cols << " " << image.rows << "\n255\n";
+	vector<unsigned char> row(static_cast<size_t>(image.cols) * channels);
+	for (int y = 0; y < image.rows && file; ++y)
+	{
+		const unsigned char* src = image.ptr(y);
+		for (int x = 0; x < image.cols * channels; x += channels)
+			for (int c = 0; c < channels; ++c)
+				row[x + c] = src[x + channels - 1 - c]; // BGR to RGB.
+		file.write(reinterpret_cast<const char*>(row.data()), static_cast<streamsize>(row.size()));
+	}
+	return static_cast<bool>(file);
+}
+
+void WriteBigEndian(vector<unsigned char>& out, uint32_t value)
+{
+	for (int shift = 24; shift >= 0; shift -= 8)
+		out.push_back(static_cast<unsigned char>(value >> shift));
+}
+
+void AppendChunk(vector<unsigned char>& out, const char* type,
+				 const unsigned char* payload, size_t length)
+{
+	WriteBigEndian(out, static_cast<uint32_t>(length));
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), payload, payload + length);
+	uLong crc = crc32(0, &out[start], static_cast<uInt>(length + 4));
+	WriteBigEndian(out, static_cast<uint32_t>(crc));
+}
+
+// Every row uses the Sub filter, which suits the smooth color gradients
+// of the images, and zlib's fastest level.
+bool WritePng(const string& path, const Mat& image)
+{
+	int channels = image.channels();
+	size_t rowBytes = static_cast<size_t>(image.cols) * channels;
+	vector<unsigned char> raw(image.rows * (rowBytes + 1));
+	for (int y = 0; y < image.rows; ++y)
+	{
+		unsigned char* dst = &raw[y * (rowBytes + 1)];
+		*dst++ = 1;
+		const unsigned char* src = image.ptr(y);
+		for (size_t x = 0; x < rowBytes; x += channels)
+		{
+			for (int c = 0; c < channels; ++c)
+			{
+				// BGR to RGB.
+				size_t i = x + channels - 1 - c;
+				unsigned char left = x ? src[i - channels] : 0;
+				dst[x + c] = static_cast<unsigned char>(src[i] - left);
+			}
+		}
+	}
+	uLongf compressedSize = compressBound(static_cast<uLong>(raw.size()));
+	vector<unsigned char> compressed(compressedSize);
+	if (compress2(compressed.data(), &compressedSize, raw.data(),
+				  static_cast<uLong>(raw.size()), Z_BEST_SPEED) != Z_OK)
+		return false;
+
+	vector<unsigned char> out(pngSignature, pngSignature + 8);
+	vector<unsigned char> header;
+	WriteBigEndian(header, static_cast<uint32_t>(image.cols));
+	WriteBigEndian(header, static_cast<uint32_t>(image.rows));
+	const unsigned char colorType = channels == 1 ? 0 : 2;
+	const unsigned char rest[] = {8, colorType, 0, 0, 0};
+	header.insert(header.end(), rest, rest + 5);
+	AppendChunk(out, "IHDR", header.data(), header.size());
+	AppendChunk(out, "IDAT", compressed.data(), compressedSize);
+	AppendChunk(out, "IEND", nullptr, 0);
+	ofstream file(path, ios::binary);
+	file.write(reinterpret_cast<const char*>(out.data()), static_cast<streamsize>(out.size()));
+	return static_cast<bool>(file);
+}
+
+}
+
+Mat::Mat(int numRows, int numCols, int type, void* pixels, size_t rowStep) :
+	rows(numRows),
+	cols(numCols),
+	step(0),
+	data(static_cast<unsigned char*>(pixels)),
+	type_(type)
+{
+	step = rowStep ? rowStep : cols * elemSize();
+}
+
+Mat::Mat(const Mat& image, const Rect& region) :
+	Mat(image)
+{
+	data = image.data + region.y * step + region.x * elemSize();
+	rows = region.height;
+	cols = region.width;
+}
+
+void Mat::create(int numRows, int numCols, int type)
+{
+	if (storage_ && rows == numRows && cols == numCols && type_ == type && isContinuous())
+		return;
+	rows = numRows;
+	cols = numCols;
+	type_ = type;
+	step = cols * elemSize();
+	// Not initialized, like OpenCV, so large blocks stay untouched
+	// until they are written first (see FirstTouchMat).
+	size_t bytes = max<size_t>(step * rows, 1);
+	storage_.reset(static_cast<unsigned char*>(::operator new(bytes)),
+				   [](unsigned char* pixels) { ::operator delete(pixels); });
+	data = storage_.get();
+}
+
+size_t Mat::elemSize() const
+{
+	return static_cast<size_t>(depthSizes[depth()] * channels());
+}
+
+void Mat::setTo(const Scalar& value)
+{
+	// One pixel of the target type, repeated.
+	unsigned char pixel[32];
+	for (int c = 0; c < channels(); ++c)
+	{
+		void* dst = pixel + c * depthSizes[depth()];
+		if (depth() == CV_8U)
+			*static_cast<unsigned char*>(dst) = static_cast<unsigned char>(
+				min(max(value[c], 0.0), 255.0) + 0.5);
+		else if (depth() == CV_32S)
+			*static_cast<int32_t*>(dst) = static_cast<int32_t>(value[c]);
+		else
+			*static_cast<double*>(dst) = value[c];
+	}
+	size_t size = elemSize();
+	for (int y = 0; y < rows; ++y)
+	{
+		unsigned char* row = ptr(y);
+		for (int x = 0; x < cols; ++x)
+			memcpy(row + x * size, pixel, size);
+	}
+}
+
+Mat Mat::clone() const
+{
+	Mat copy(rows, cols, type_);
+	for (int y = 0; y < rows; ++y)
+		memcpy(copy.ptr(y), ptr(y), cols * elemSize());
+	return copy;
+}
+
+Mat imread(const string& path, int flags)
+{
+	ifstream file(path, ios::binary);
+	if (!file)
+		return Mat();
+	if (file.peek() == pngSignature[0])
+		return ReadPng(file, flags);
+	return ReadPnm(file, flags);
+}
+
+bool imwrite(const string& path, const Mat& image)
+{
+	if (image.depth() != CV_8U || (image.channels() != 1 && image.channels() != 3))
+		return false;
+	if (EndsWith(path, ".png"))
+		return WritePng(path, image);
+	if (EndsWith(path, ".ppm") || EndsWith(path, ".pgm") || EndsWith(path, ".pnm"))
+		return WritePnm(path, image);
+	cout << "Without OpenCV only PNG, PPM and PGM files can be written: " << path << endl;
+	return false;
+}
+
+}
+
+#endif
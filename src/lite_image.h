@@ -0,0 +1,183 @@
+#pragma once
+
+// The subset of the OpenCV API the program uses, for builds without OpenCV
+// (scons opencv=no). Same names and semantics, so the rest of the code
+// compiles against either. Images are read from and written to PNG,
+// PPM and PGM files only.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#define CV_8U 0
+#define CV_32S 4
+#define CV_64F 6
+#define CV_MAKETYPE(depth, channels) ((depth) + (((channels) - 1) << 3))
+#define CV_8UC1 CV_MAKETYPE(CV_8U, 1)
+#define CV_8UC3 CV_MAKETYPE(CV_8U, 3)
+#define CV_32SC1 CV_MAKETYPE(CV_32S, 1)
+#define CV_32SC4 CV_MAKETYPE(CV_32S, 4)
+#define CV_64FC4 CV_MAKETYPE(CV_64F, 4)
+
+namespace cv
+{
+
+enum
+{
+	IMREAD_GRAYSCALE = 0,
+	IMREAD_COLOR = 1
+};
+
+template<class T, int n>
+class Vec
+{
+public:
+	Vec() { std::fill(val, val + n, T()); }
+	Vec(T v0, T v1, T v2) : Vec() { val[0] = v0; val[1] = v1; val[2] = v2; }
+	Vec(T v0, T v1, T v2, T v3) : Vec(v0, v1, v2) { val[3] = v3; }
+	T& operator[](int i) { return val[i]; }
+	const T& operator[](int i) const { return val[i]; }
+	bool operator==(const Vec& other) const { return std::equal(val, val + n, other.val); }
+	bool operator!=(const Vec& other) const { return !(*this == other); }
+	T val[n];
+};
+
+typedef Vec<unsigned char, 3> Vec3b;
+typedef Vec<int, 4> Vec4i;
+typedef Vec<double, 4> Vec4d;
+
+template<class T>
+class Scalar_ : public Vec<T, 4>
+{
+public:
+	Scalar_(T v0 = 0, T v1 = 0, T v2 = 0, T v3 = 0) : Vec<T, 4>(v0, v1, v2, v3) {}
+	template<class U>
+	operator Scalar_<U>() const
+	{
+		const Scalar_& s = *this;
+		return Scalar_<U>(static_cast<U>(s[0]), static_cast<U>(s[1]),
+						  static_cast<U>(s[2]), static_cast<U>(s[3]));
+	}
+};
+
+typedef Scalar_<double> Scalar;
+
+struct Size
+{
+	Size(int w = 0, int h = 0) : width(w), height(h) {}
+	int area() const { return width * height; }
+	bool operator==(const Size& other) const { return width == other.width && height == other.height; }
+	bool operator!=(const Size& other) const { return !(*this == other); }
+	int width;
+	int height;
+};
+
+struct Point
+{
+	Point(int px = 0, int py = 0) : x(px), y(py) {}
+	int x;
+	int y;
+};
+
+struct Rect
+{
+	Rect(int rx = 0, int ry = 0, int w = 0, int h = 0) : x(rx), y(ry), width(w), height(h) {}
+	int area() const { return width * height; }
+	Point tl() const { return Point(x, y); }
+	Point br() const { return Point(x + width, y + height); }
+	bool contains(const Point& p) const
+	{
+		return p.x >= x && p.x < x + width && p.y >= y && p.y < y + height;
+	}
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+// Intersection, empty if they do not overlap.
+inline Rect operator&(const Rect& r1, const Rect& r2)
+{
+	int x0 = std::max(r1.x, r2.x);
+	int y0 = std::max(r1.y, r2.y);
+	int x1 = std::min(r1.x + r1.width, r2.x + r2.width);
+	int y1 = std::min(r1.y + r1.height, r2.y + r2.height);
+	if (x1 <= x0 || y1 <= y0)
+		return Rect();
+	return Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+inline bool operator==(const Rect& r1, const Rect& r2)
+{
+	return r1.x == r2.x && r1.y == r2.y && r1.width == r2.width && r1.height == r2.height;
+}
+
+inline bool operator!=(const Rect& r1, const Rect& r2)
+{
+	return !(r1 == r2);
+}
+
+// 2D array of pixels with reference counted storage. Copies share the
+// pixels, like with OpenCV, clone() and copyTo() copy them.
+class Mat
+{
+public:
+	Mat() : rows(0), cols(0), step(0), data(nullptr), type_(CV_8UC1) {}
+	Mat(int numRows, int numCols, int type) : Mat() { create(numRows, numCols, type); }
+	Mat(Size size, int type) : Mat(size.height, size.width, type) {}
+	Mat(int numRows, int numCols, int type, const Scalar& value) : Mat(numRows, numCols, type)
+	{
+		setTo(value);
+	}
+	Mat(Size size, int type, const Scalar& value) : Mat(size.height, size.width, type, value) {}
+	// Wraps external pixels without taking ownership.
+	Mat(int numRows, int numCols, int type, void* pixels, std::size_t rowStep = 0);
+	Mat(Size size, int type, void* pixels, std::size_t rowStep = 0) :
+		Mat(size.height, size.width, type, pixels, rowStep) {}
+	// View of a region, sharing the pixels.
+	Mat(const Mat& image, const Rect& region);
+	Mat operator()(const Rect& region) const { return Mat(*this, region); }
+	Mat rowRange(int begin, int end) const { return Mat(*this, Rect(0, begin, cols, end - begin)); }
+
+	void create(int numRows, int numCols, int type);
+	void release() { *this = Mat(); }
+	void setTo(const Scalar& value);
+	Mat clone() const;
+	void copyTo(Mat& other) const { other = clone(); }
+
+	int type() const { return type_; }
+	int depth() const { return type_ & 7; }
+	int channels() const { return (type_ >> 3) + 1; }
+	std::size_t elemSize() const;
+	std::size_t total() const { return static_cast<std::size_t>(rows) * cols; }
+	bool empty() const { return !data || !rows || !cols; }
+	bool isContinuous() const { return step == cols * elemSize(); }
+	Size size() const { return Size(cols, rows); }
+
+	unsigned char* ptr(int y = 0) { return data + y * step; }
+	const unsigned char* ptr(int y = 0) const { return data + y * step; }
+	template<class T> T* ptr(int y = 0) { return reinterpret_cast<T*>(ptr(y)); }
+	template<class T> const T* ptr(int y = 0) const { return reinterpret_cast<const T*>(ptr(y)); }
+	template<class T> T& at(int y, int x) { return ptr<T>(y)[x]; }
+	template<class T> const T& at(int y, int x) const { return ptr<T>(y)[x]; }
+
+	int rows;
+	int cols;
+	std::size_t step; // Bytes per row.
+	unsigned char* data;
+private:
+	int type_;
+	std::shared_ptr<unsigned char> storage_;
+};
+
+// Reads PNG (8 bit, not interlaced), PPM and PGM files as BGR or gray
+// images. Returns an empty image on errors.
+Mat imread(const std::string& path, int flags = IMREAD_COLOR);
+
+// Writes a BGR or gray image as PNG, PPM or PGM, by the file extension.
+bool imwrite(const std::string& path, const Mat& image);
+
+}
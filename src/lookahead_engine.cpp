@@ -0,0 +1,130 @@
+#include "lookahead_engine.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+using namespace cv;
+using namespace std;
+
+LookaheadSearch::LookaheadSearch(size_t depth) :
+	depth_(max<size_t>(depth, 1)),
+	placements_(0),
+	scans_(0),
+	rescannedColors_(0)
+{
+}
+
+Pos LookaheadSearch::FindBestPos(const Mat& image, const Frontier& frontier,
+								 const vector<Color>& colors)
+{
+	assert(!colors.empty() && !frontier.Empty());
+	// pending_[i] belongs to colors[colors.size() - 1 - i].
+	while (pending_.size() < min(depth_, colors.size()))
+	{
+		Pending pending;
+		pending.color = colors[colors.size() - 1 - pending_.size()];
+		pending.valid = false;
+		pending_.push_back(pending);
+	}
+	if (!pending_.front().valid)
+		Rescan(image, frontier);
+	return pending_.front().pos;
+}
+
+void LookaheadSearch::Rescan(const Mat& image, const Frontier& frontier)
+{
+	vector<Pending*> invalid;
+	for (Pending& pending : pending_)
+	{
+		if (pending.valid)
+			continue;
+		pending.diff = numeric_limits<double>::infinity();
+		invalid.push_back(&pending);
+	}
+	Color neighbours[9];
+	for (const Pos& pos : frontier)
+	{
+		int colorCount = FilledNeighbours(image, pos, neighbours);
+		for (Pending* pending : invalid)
+		{
+			double diff = ColorPosDiff(neighbours, colorCount, pending->color);
+			if (IsBetter(diff, pos, pending->diff, pending->pos))
+			{
+				pending->diff = diff;
+				pending->pos = pos;
+			}
+		}
+	}
+	for (Pending* pending : invalid)
+		pending->valid = true;
+	++scans_;
+	rescannedColors_ += invalid.size();
+}
+
+void LookaheadSearch::Placed(const Mat& image, const Frontier& frontier,
+							 const Pos& pos)
+{
+	pending_.pop_front();
+	++placements_;
+
+	vector<Pos> changed;
+	for (PosComponent nx = pos.first-spread; nx <= pos.first+spread; ++nx)
+		for (PosComponent ny = pos.second-spread; ny <= pos.second+spread; ++ny)
+			if (IsInside(image, nx, ny) && frontier.Contains(Pos(nx, ny)))
+				changed.push_back(Pos(nx, ny));
+
+	for (Pending& pending : pending_)
+	{
+		if (!pending.valid)
+			continue;
+		if (abs(pending.pos.first - pos.first) <= spread &&
+			abs(pending.pos.second - pos.second) <= spread)
+		{
+			// Its score may have risen, or it is taken.
+			pending.valid = false;
+			continue;
+		}
+		for (const Pos& changedPos : changed)
+		{
+			double diff = ColorPosDiff(image, changedPos, pending.color);
+			if (IsBetter(diff, changedPos, pending.diff, pending.pos))
+			{
+				pending.diff = diff;
+				pending.pos = changedPos;
+			}
+		}
+	}
+}
+
+void LookaheadSearch::PrintStats() const
+{
+	cout << "frontier scans: " << scans_ << " for " << placements_
+		<< " placements, " << rescannedColors_ / max(scans_, 1ULL)
+		<< " colors per scan on average" << endl;
+}
+
+void GrowLookahead(Mat& image, const set<Pos>& initPositions,
+				   vector<Color>& colors, size_t depth, SnapshotWriter& snapshots)
+{
+	Frontier nextPositions(image.size());
+	for (const Pos& pos : initPositions)
+		nextPositions.Insert(pos);
+	LookaheadSearch search(depth);
+
+	while (!colors.empty() && !nextPositions.Empty())
+	{
+		Pos pos = search.FindBestPos(image, nextPositions, colors);
+		Color color = colors.back();
+		colors.pop_back();
+		nextPositions.Erase(pos);
+		SetPixel(image, pos.first, pos.second, color);
+		snapshots.Placed(pos, color);
+		for (const Pos& freePos : GetFreeNeighbours(image, pos))
+			nextPositions.Insert(freePos);
+		search.Placed(image, nextPositions, pos);
+		snapshots.Update(image, colors.size(), nextPositions.Size());
+	}
+	search.PrintStats();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.h"
+#include "frontier.h"
+#include "output.h"
+
+#include <deque>
+#include <set>
+#include <vector>
+
+// Exact search that keeps the best position of the next colors of the
+// queue. A single pass over the frontier rates all colors whose result is
+// missing, so the neighbourhood of every position is loaded once for all
+// of them. A placement only changes the scores of the positions in its
+// 3x3 neighbourhood. Results lying there are rescanned with the next pass,
+// the others are kept and only compared against the changed positions.
+// Ties are broken by position.
+class LookaheadSearch
+{
+public:
+	explicit LookaheadSearch(std::size_t depth);
+	// The best position of colors.back().
+	Pos FindBestPos(const cv::Mat& image, const Frontier& frontier,
+					const std::vector<Color>& colors);
+	// To be called after colors.back() was placed at pos and popped,
+	// and the frontier was updated.
+	void Placed(const cv::Mat& image, const Frontier& frontier, const Pos& pos);
+	void PrintStats() const;
+private:
+	struct Pending
+	{
+		Color color;
+		double diff;
+		Pos pos;
+		bool valid;
+	};
+	void Rescan(const cv::Mat& image, const Frontier& frontier);
+	std::size_t depth_;
+	std::deque<Pending> pending_;
+	unsigned long long placements_;
+	unsigned long long scans_;
+	unsigned long long rescannedColors_;
+};
+
+void GrowLookahead(cv::Mat& image, const std::set<Pos>& initPositions,
+				   std::vector<Color>& colors, std::size_t depth,
+				   SnapshotWriter& snapshots);
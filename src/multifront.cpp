@@ -0,0 +1,255 @@
+#include "multifront.h"
+#include "frontier.h"
+#include "parallel.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+// Colors placed per front between two snapshot updates.
+const size_t roundSize = 256;
+
+// A pixel of the occupancy map: 0 while free, else the owning front + 1
+// in the top byte and the color in the lower three.
+typedef uint32_t Cell;
+
+Cell MakeCell(size_t front, const Color& color)
+{
+	return static_cast<Cell>(front + 1) << 24 | color[2] << 16 | color[1] << 8 | color[0];
+}
+
+Color CellColor(Cell cell)
+{
+	return Color(cell & 0xFF, (cell >> 8) & 0xFF, (cell >> 16) & 0xFF);
+}
+
+// The committed pixels, only changed between the rounds,
+// so every front sees the same state during a round.
+class OccupancyMap
+{
+public:
+	explicit OccupancyMap(Size size) : size_(size), cells_(size.area(), 0) {}
+	bool IsInside(PosComponent x, PosComponent y) const
+	{
+		return x >= 0 && x < size_.width && y >= 0 && y < size_.height;
+	}
+	size_t Index(const Pos& pos) const
+	{
+		return static_cast<size_t>(pos.second) * size_.width + pos.first;
+	}
+	Cell Get(const Pos& pos) const { return cells_[Index(pos)]; }
+	void Set(const Pos& pos, Cell cell) { cells_[Index(pos)] = cell; }
+private:
+	Size size_;
+	vector<Cell> cells_;
+};
+
+struct Placement
+{
+	Pos pos;
+	Color color;
+	double diff;
+};
+
+struct Front
+{
+	explicit Front(Size size) : frontier(size), own(size.area(), 0) {}
+	Frontier frontier;
+	vector<Color> colors; // Hue sorted, popped from the back.
+	vector<Placement> placed; // Tentative, during the current round.
+	vector<uint16_t> own; // Index into placed + 1 for this round's pixels.
+};
+
+// A cell as the front sees it: committed or placed by itself this round.
+Cell FrontCell(const OccupancyMap& occupancy, const Front& front, size_t id, const Pos& pos)
+{
+	Cell cell = occupancy.Get(pos);
+	if (cell)
+		return cell;
+	uint16_t index = front.own[occupancy.Index(pos)];
+	return index ? MakeCell(id, front.placed[index - 1].color) : 0;
+}
+
+// Like FilledNeighbours on a canvas.
+int FilledNeighbours(const OccupancyMap& occupancy, const Front& front, size_t id,
+					 const Pos& pos, Color* neighbours)
+{
+	int count = 0;
+	for (PosComponent ny = pos.second - spread; ny <= pos.second + spread; ++ny)
+	{
+		for (PosComponent nx = pos.first - spread; nx <= pos.first + spread; ++nx)
+		{
+			if (!occupancy.IsInside(nx, ny))
+				continue;
+			Cell cell = FrontCell(occupancy, front, id, Pos(nx, ny));
+			if (cell)
+				neighbours[count++] = CellColor(cell);
+		}
+	}
+	return count;
+}
+
+// Places up to roundSize colors of the front tentatively.
+void GrowRound(Front& front, size_t id, const OccupancyMap& occupancy)
+{
+	front.placed.clear();
+	vector<Pos> taken;
+	while (front.placed.size() < roundSize && !front.colors.empty()
+		   && !front.frontier.Empty())
+	{
+		Color color = front.colors.back();
+		double bestDiff = numeric_limits<double>::infinity();
+		Pos bestPos;
+		Color neighbours[9];
+		taken.clear();
+		for (const Pos& pos : front.frontier)
+		{
+			if (occupancy.Get(pos))
+			{
+				taken.push_back(pos);
+				continue;
+			}
+			int count = FilledNeighbours(occupancy, front, id, pos, neighbours);
+			double diff = ColorPosDiff(neighbours, count, color);
+			if (IsBetter(diff, pos, bestDiff, bestPos))
+			{
+				bestDiff = diff;
+				bestPos = pos;
+			}
+		}
+		// Positions committed by other fronts are dropped lazily.
+		for (const Pos& pos : taken)
+			front.frontier.Erase(pos);
+		if (front.frontier.Empty())
+			break;
+		front.frontier.Erase(bestPos);
+		front.colors.pop_back();
+		front.placed.push_back(Placement{bestPos, color, bestDiff});
+		front.own[occupancy.Index(bestPos)] = static_cast<uint16_t>(front.placed.size());
+		for (PosComponent ny = bestPos.second - spread; ny <= bestPos.second + spread; ++ny)
+			for (PosComponent nx = bestPos.first - spread; nx <= bestPos.first + spread; ++nx)
+				if (occupancy.IsInside(nx, ny) && !FrontCell(occupancy, front, id, Pos(nx, ny)))
+					front.frontier.Insert(Pos(nx, ny));
+	}
+}
+
+// Resolves the pixels placed by several fronts in the same round: the lowest
+// score wins, then the lowest front id. The losers get their colors back,
+// to be placed next. Commits the winners and returns them in front order.
+vector<pair<Pos, Color>> Commit(vector<unique_ptr<Front>>& fronts, OccupancyMap& occupancy)
+{
+	unordered_map<size_t, pair<size_t, double>> winners; // Pixel index -> front, score.
+	for (size_t id = 0; id < fronts.size(); ++id)
+	{
+		for (const Placement& placement : fronts[id]->placed)
+		{
+			auto inserted = winners.insert(make_pair(occupancy.Index(placement.pos),
+													 make_pair(id, placement.diff)));
+			// Fronts are visited by increasing id, so equal scores keep the first.
+			if (!inserted.second && placement.diff < inserted.first->second.second)
+				inserted.first->second = make_pair(id, placement.diff);
+		}
+	}
+	vector<pair<Pos, Color>> committed;
+	for (size_t id = 0; id < fronts.size(); ++id)
+	{
+		Front& front = *fronts[id];
+		vector<Color> lost;
+		for (const Placement& placement : front.placed)
+		{
+			front.own[occupancy.Index(placement.pos)] = 0;
+			if (winners[occupancy.Index(placement.pos)].first != id)
+			{
+				lost.push_back(placement.color);
+				continue;
+			}
+			occupancy.Set(placement.pos, MakeCell(id, placement.color));
+			committed.push_back(make_pair(placement.pos, placement.color));
+		}
+		// The first lost color ends up at the back again.
+		front.colors.insert(front.colors.end(), lost.rbegin(), lost.rend());
+	}
+	return committed;
+}
+
+// Hands the colors of enclosed fronts to the front with the largest
+// frontier. Returns whether any colors were handed over.
+bool HandOver(vector<unique_ptr<Front>>& fronts)
+{
+	auto receiver = max_element(fronts.begin(), fronts.end(),
+		[](const unique_ptr<Front>& f1, const unique_ptr<Front>& f2) -> bool
+	{
+		return f1->frontier.Size() < f2->frontier.Size();
+	});
+	if ((*receiver)->frontier.Empty())
+		return false;
+	auto hueLess = [](const Color& c1, const Color& c2) -> bool
+	{
+		return bgr2hsv(c1)[0] < bgr2hsv(c2)[0];
+	};
+	bool handedOver = false;
+	for (unique_ptr<Front>& front : fronts)
+	{
+		if (!front->frontier.Empty() || front->colors.empty())
+			continue;
+		vector<Color>& target = (*receiver)->colors;
+		vector<Color> merged(target.size() + front->colors.size());
+		merge(target.begin(), target.end(), front->colors.begin(), front->colors.end(),
+			  merged.begin(), hueLess);
+		target.swap(merged);
+		front->colors.clear();
+		handedOver = true;
+	}
+	return handedOver;
+}
+
+}
+
+void GrowMultiFront(Mat& image, const vector<set<Pos>>& seedFronts,
+					const vector<Color>& colors, SnapshotWriter& snapshots)
+{
+	OccupancyMap occupancy(image.size());
+	vector<unique_ptr<Front>> fronts;
+	for (size_t i = 0; i < seedFronts.size(); ++i)
+	{
+		fronts.emplace_back(new Front(image.size()));
+		for (const Pos& pos : seedFronts[i])
+			fronts.back()->frontier.Insert(pos);
+		// Contiguous hue sectors, the colors stay sorted within each.
+		size_t begin = colors.size() * i / seedFronts.size();
+		size_t end = colors.size() * (i + 1) / seedFronts.size();
+		fronts.back()->colors.assign(colors.begin() + begin, colors.begin() + end);
+	}
+
+	size_t colorsLeft = colors.size();
+	for (;;)
+	{
+		// One thread per front, as long as there are enough cores. The fronts
+		// only read the committed pixels, so the result does not depend on
+		// the timing of the threads.
+		ParallelFor(fronts.size(), [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+				GrowRound(*fronts[i], i, occupancy);
+		});
+		vector<pair<Pos, Color>> committed = Commit(fronts, occupancy);
+		size_t frontierSize = 0;
+		for (const unique_ptr<Front>& front : fronts)
+			frontierSize += front->frontier.Size();
+		for (const pair<Pos, Color>& placement : committed)
+		{
+			SetPixel(image, placement.first.first, placement.first.second, placement.second);
+			snapshots.Placed(placement.first, placement.second);
+			snapshots.Update(image, --colorsLeft, frontierSize);
+		}
+		if (!HandOver(fronts) && committed.empty())
+			break;
+	}
+}
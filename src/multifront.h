@@ -0,0 +1,21 @@
+#pragma once
+
+#include "common.h"
+#include "output.h"
+
+#include <set>
+#include <vector>
+
+// One growth front per fixed seed point, all growing concurrently.
+// The hue sorted palette is split into one hue sector per seed, in the
+// order of the seed points, and every front places the colors of its
+// sector with the usual exact search over its own frontier.
+// The fronts grow in rounds of 256 colors. During a round every front sees
+// the pixels committed before it and its own new ones. Between the rounds
+// the new pixels are committed; a pixel placed by several fronts goes to
+// the one with the lowest score, then the lowest index, and the others get
+// their colors back. So the result does not depend on the thread timing.
+// A front that is enclosed by others hands its remaining colors to the
+// front with the largest frontier, merged into that one's hue order.
+void GrowMultiFront(cv::Mat& image, const std::vector<std::set<Pos>>& seedFronts,
+					const std::vector<Color>& colors, SnapshotWriter& snapshots);
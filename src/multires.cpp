@@ -0,0 +1,196 @@
+#include "multires.h"
+#include "color_engine.h"
+#include "numa.h"
+#include "parallel.h"
+
+#include <numeric>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+struct PaletteLevel
+{
+	vector<Color> colors;
+	// The members of group i are
+	// members[memberStart[i]] ... members[memberStart[i+1] - 1]
+	// and index the colors of the next finer level.
+	vector<int> memberStart;
+	vector<int> members;
+};
+
+// Groups four colors that are neighbours in Morton order,
+// i.e. close in the RGB cube, into their mean color.
+PaletteLevel Coarsen(const vector<Color>& fine)
+{
+	vector<uint32_t> codes(fine.size());
+	transform(fine.begin(), fine.end(), codes.begin(), MortonCode);
+	vector<int> order(fine.size());
+	iota(order.begin(), order.end(), 0);
+	stable_sort(order.begin(), order.end(), [&](int i1, int i2) -> bool
+	{
+		return codes[i1] < codes[i2];
+	});
+
+	PaletteLevel coarse;
+	coarse.members = order;
+	for (size_t i = 0; i < order.size(); i += 4)
+	{
+		size_t end = min(i + 4, order.size());
+		int sum[3] = {0, 0, 0};
+		for (size_t j = i; j < end; ++j)
+			for (int c = 0; c < 3; ++c)
+				sum[c] += fine[order[j]][c];
+		int n = static_cast<int>(end - i);
+		coarse.colors.push_back(Color((sum[0] + n/2) / n, (sum[1] + n/2) / n,
+									  (sum[2] + n/2) / n));
+		coarse.memberStart.push_back(static_cast<int>(i));
+	}
+	coarse.memberStart.push_back(static_cast<int>(order.size()));
+	return coarse;
+}
+
+Size LevelSize(const Mat& image, int level)
+{
+	int scale = 1 << level;
+	return Size((image.cols + scale - 1) / scale, (image.rows + scale - 1) / scale);
+}
+
+// Fills the 2x2 block of the coarse pixel (cx, cy) with the members of its group.
+void RefineBlock(const Mat& coarse, PosComponent cx, PosComponent cy,
+				 const vector<Color>& fineColors, vector<int>& members,
+				 Mat& patch, Mat& fine, Mat& fineIds)
+{
+	// The block with a one pixel border. The border is taken from the
+	// coarse level, so neighbouring blocks do not depend on each other.
+	vector<Pos> cells;
+	for (PosComponent py = 0; py < 4; ++py)
+	{
+		for (PosComponent px = 0; px < 4; ++px)
+		{
+			PosComponent fx = 2*cx - 1 + px;
+			PosComponent fy = 2*cy - 1 + py;
+			bool inner = px >= 1 && px <= 2 && py >= 1 && py <= 2;
+			Color color(invalidColor, invalidColor, invalidColor);
+			if (IsInside(fine, fx, fy))
+			{
+				if (inner)
+					cells.push_back(Pos(px, py));
+				else
+					color = GetPixel(coarse, fx / 2, fy / 2);
+			}
+			SetPixel(patch, px, py, color);
+		}
+	}
+
+	sort(members.begin(), members.end(), [&](int i1, int i2) -> bool
+	{
+		return bgr2hsv(fineColors[i1])[0] < bgr2hsv(fineColors[i2])[0];
+	});
+	while (!members.empty() && !cells.empty())
+	{
+		int member = members.back();
+		members.pop_back();
+		Color color = fineColors[member];
+		auto best = min_element(cells.begin(), cells.end(),
+			[&](const Pos& p1, const Pos& p2) -> bool
+		{
+			return ColorPosDiff(patch, p1, color) < ColorPosDiff(patch, p2, color);
+		});
+		SetPixel(patch, best->first, best->second, color);
+		PosComponent fx = 2*cx - 1 + best->first;
+		PosComponent fy = 2*cy - 1 + best->second;
+		SetPixel(fine, fx, fy, color);
+		fineIds.at<int>(fy, fx) = member;
+		cells.erase(best);
+	}
+}
+
+void RefineLevel(const Mat& coarse, const Mat& coarseIds,
+				 const PaletteLevel& groups, const vector<Color>& fineColors,
+				 Mat& fine, Mat& fineIds)
+{
+	ParallelFor(coarse.rows, [&](size_t begin, size_t end)
+	{
+		Mat patch(4, 4, ImageType);
+		vector<int> members;
+		for (PosComponent cy = begin; cy < static_cast<PosComponent>(end); ++cy)
+		{
+			for (PosComponent cx = 0; cx < coarse.cols; ++cx)
+			{
+				int id = coarseIds.at<int>(cy, cx);
+				if (id < 0)
+					continue;
+				members.assign(groups.members.begin() + groups.memberStart[id],
+							   groups.members.begin() + groups.memberStart[id + 1]);
+				RefineBlock(coarse, cx, cy, fineColors, members, patch, fine, fineIds);
+			}
+		}
+	});
+}
+
+}
+
+void GrowMultiResolution(Mat& image, const set<Pos>& initPositions,
+						 const vector<Color>& colors, int levels,
+						 const ColorEngineSettings& settings,
+						 mt19937& g, SnapshotWriter& snapshots)
+{
+	vector<PaletteLevel> palettes(1);
+	palettes[0].colors = colors;
+	for (int level = 1; level <= levels; ++level)
+		palettes.push_back(Coarsen(palettes.back().colors));
+
+	// Grow the coarsest level with the usual hue sorted color queue.
+	const vector<Color>& coarsestColors = palettes[levels].colors;
+	vector<int> ids(coarsestColors.size());
+	iota(ids.begin(), ids.end(), 0);
+	shuffle(ids.begin(), ids.end(), g);
+	vector<double> hues(coarsestColors.size());
+	transform(coarsestColors.begin(), coarsestColors.end(), hues.begin(),
+		[](const Color& color) { return bgr2hsv(color)[0]; });
+	sort(ids.begin(), ids.end(), [&](int i1, int i2) -> bool
+	{
+		return hues[i1] < hues[i2];
+	});
+	vector<Color> queue(ids.size());
+	transform(ids.begin(), ids.end(), queue.begin(),
+		[&](int id) { return coarsestColors[id]; });
+
+	Mat coarse(LevelSize(image, levels), ImageType, Scalar_<Channel>(invalidColor));
+	Mat coarseIds(coarse.size(), CV_32SC1, Scalar_<int>(-1));
+	set<Pos> nextPositions;
+	for (const Pos& pos : initPositions)
+		nextPositions.insert(Pos(pos.first >> levels, pos.second >> levels));
+	SnapshotWriter coarseSnapshots(queue.size(), "./output/coarse");
+	ColorRuns queueRuns(queue);
+	GrowColorDriven(coarse, nextPositions, queueRuns, settings, g,
+					coarseSnapshots,
+		[&](const Pos& pos, size_t idx)
+	{
+		coarseIds.at<int>(pos.second, pos.first) = ids[idx];
+	});
+
+	// The levels have other sizes than the canvas, so they go to the coarse
+	// series, not to the main one and its listeners.
+	for (int level = levels; level > 0; --level)
+	{
+		coarseSnapshots.Write(coarse);
+		// The rows of a block range are refined by the same worker.
+		Mat fine = FirstTouchMat(LevelSize(image, level - 1), ImageType, Scalar(invalidColor));
+		Mat fineIds = FirstTouchMat(fine.size(), CV_32SC1, Scalar(-1));
+		RefineLevel(coarse, coarseIds, palettes[level],
+					palettes[level - 1].colors, fine, fineIds);
+		coarse = fine;
+		coarseIds = fineIds;
+	}
+	image = coarse;
+	// The blocks were refined in parallel, report the pixels afterwards.
+	for (PosComponent y = 0; y < image.rows; ++y)
+		for (PosComponent x = 0; x < image.cols; ++x)
+			if (!IsFree(image, x, y))
+				snapshots.Placed(Pos(x, y), GetPixel(image, x, y));
+	snapshots.Write(image);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "color_engine.h"
+#include "common.h"
+#include "output.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+// Coarse to fine growth for huge canvases.
+// The palette is grouped into quadruples of nearby colors, level by level,
+// and the color engine runs on a 2^levels times smaller canvas with the
+// mean colors of the coarsest groups. Every coarse pixel then becomes a 2x2
+// block that is filled with the members of its group, using ColorPosDiff
+// against the upsampled coarse level around the block. Blocks only read the
+// coarse level, so all blocks of a level are refined in parallel.
+// settings apply to the color engine on the coarsest level.
+void GrowMultiResolution(cv::Mat& image, const std::set<Pos>& initPositions,
+						 const std::vector<Color>& colors, int levels,
+						 const ColorEngineSettings& settings,
+						 std::mt19937& g, SnapshotWriter& snapshots);
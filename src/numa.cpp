@@ -0,0 +1,274 @@
+#include "numa.h"
+#include "huge_pages.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+const string nodeDir = "/sys/devices/system/node/node";
+// Size of the node masks passed to mbind.
+const int maxNodes = 1024;
+
+// Parses cpu lists like "0-3,8,10-11".
+vector<int> ParseCpuList(const string& list)
+{
+	vector<int> cpus;
+	istringstream ss(list);
+	string range;
+	while (getline(ss, range, ','))
+	{
+		int first = 0, last = 0;
+		char dash = 0;
+		istringstream rs(range);
+		if (!(rs >> first))
+			continue;
+		if (rs >> dash >> last && dash == '-')
+			for (int cpu = first; cpu <= last; ++cpu)
+				cpus.push_back(cpu);
+		else
+			cpus.push_back(first);
+	}
+	return cpus;
+}
+
+NumaTopology ReadTopology()
+{
+	NumaTopology topology;
+	for (int node = 0; ; ++node)
+	{
+		ifstream file(nodeDir + to_string(node) + "/cpulist");
+		string list;
+		if (!getline(file, list))
+			break;
+		topology.nodeCpus.push_back(ParseCpuList(list));
+	}
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	bool known = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+	if (topology.nodeCpus.empty())
+	{
+		topology.nodeCpus.resize(1);
+		for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+			if (known && CPU_ISSET(cpu, &allowed))
+				topology.nodeCpus[0].push_back(cpu);
+	}
+	for (const vector<int>& cpus : topology.nodeCpus)
+		for (int cpu : cpus)
+			if (!known || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)))
+				topology.usableCpus.push_back(cpu);
+	return topology;
+}
+
+size_t PageSize()
+{
+	static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	return pageSize;
+}
+
+// Whether memory for node is placed explicitly.
+bool Placed(int node)
+{
+	return node >= 0 && node < maxNodes && Topology().nodeCpus.size() > 1;
+}
+
+}
+
+int NumaTopology::NodeOf(int cpu) const
+{
+	for (size_t node = 0; node < nodeCpus.size(); ++node)
+		if (find(nodeCpus[node].begin(), nodeCpus[node].end(), cpu) != nodeCpus[node].end())
+			return static_cast<int>(node);
+	return -1;
+}
+
+const NumaTopology& Topology()
+{
+	static const NumaTopology topology = ReadTopology();
+	return topology;
+}
+
+int WorkerCpu(size_t worker)
+{
+	const vector<int>& cpus = Topology().usableCpus;
+	if (cpus.empty())
+		return -1;
+	// Fill the nodes one after another, in the order of the workers.
+	size_t numThreads = NumThreads();
+	size_t slot = numThreads > cpus.size() ? worker % cpus.size()
+		: worker * cpus.size() / numThreads;
+	return cpus[slot];
+}
+
+int WorkerNode(size_t worker)
+{
+	return Topology().NodeOf(WorkerCpu(worker));
+}
+
+bool PinThread(int cpu)
+{
+	if (cpu < 0 || cpu >= CPU_SETSIZE)
+		return false;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void BindToNode(void* data, size_t bytes, int node, bool move)
+{
+	if (!Placed(node))
+		return;
+	const size_t pageSize = PageSize();
+	uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + pageSize - 1) / pageSize * pageSize;
+	uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) / pageSize * pageSize;
+	if (begin >= end)
+		return;
+	const int bits = 8 * sizeof(unsigned long);
+	unsigned long mask[maxNodes / bits] = {};
+	mask[node / bits] = 1UL << (node % bits);
+	// Preferred, so a full node does not make the allocation fail.
+	syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED, mask, maxNodes + 1,
+			move ? MPOL_MF_MOVE : 0);
+}
+
+void* AllocateOnNode(size_t bytes, int node)
+{
+	if (!Placed(node) || bytes < PageSize())
+		return AllocateLarge(bytes);
+	if (bytes >= hugePageSize)
+	{
+		void* data = AllocateLarge(bytes);
+		BindToNode(data, bytes, node, false);
+		return data;
+	}
+	size_t size = (bytes + PageSize() - 1) / PageSize() * PageSize();
+	void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED)
+		throw bad_alloc();
+	BindToNode(data, size, node, false);
+	return data;
+}
+
+void FreeOnNode(void* data, size_t bytes, int node)
+{
+	if (!Placed(node) || bytes < PageSize() || bytes >= hugePageSize)
+		FreeLarge(data, bytes);
+	else
+		munmap(data, (bytes + PageSize() - 1) / PageSize() * PageSize());
+}
+
+Mat FirstTouchMat(Size size, int type, const Scalar& value)
+{
+	// The allocator may return pages that are already placed, e.g. reused
+	// heap memory, so the rows of every worker are bound to its node.
+	Mat result(size, type);
+	AdviseHugePages(result.data, result.total() * result.elemSize());
+	size_t numThreads = min(NumThreads(), max<size_t>(size.height, 1));
+	for (size_t worker = 0; worker < numThreads; ++worker)
+	{
+		int beginRow = static_cast<int>(size.height * worker / numThreads);
+		int endRow = static_cast<int>(size.height * (worker + 1) / numThreads);
+		if (beginRow < endRow)
+			BindToNode(result.ptr(beginRow), static_cast<size_t>(result.ptr(endRow - 1)
+					   - result.ptr(beginRow)) + result.cols * result.elemSize(),
+					   WorkerNode(worker), true);
+	}
+	ParallelFor(static_cast<size_t>(size.height), [&](size_t begin, size_t end)
+	{
+		result.rowRange(static_cast<int>(begin), static_cast<int>(end)).setTo(value);
+	});
+	return result;
+}
+
+NumaReport::NumaReport() :
+	start_(ReadCounters())
+{
+}
+
+NumaReport::Counters NumaReport::ReadCounters()
+{
+	Counters counters{0, 0};
+	for (size_t node = 0; node < Topology().nodeCpus.size(); ++node)
+	{
+		ifstream file(nodeDir + to_string(node) + "/numastat");
+		string name;
+		uint64_t value = 0;
+		while (file >> name >> value)
+		{
+			if (name == "local_node")
+				counters.local += value;
+			else if (name == "other_node")
+				counters.remote += value;
+		}
+	}
+	return counters;
+}
+
+void NumaReport::Print(const Mat& image) const
+{
+	const NumaTopology& topology = Topology();
+	cout << "NUMA nodes: " << topology.nodeCpus.size() << ", usable cpus:";
+	for (int cpu : topology.usableCpus)
+		cout << " " << cpu << "(" << topology.NodeOf(cpu) << ")";
+	cout << endl;
+
+	// System wide, so other processes are included.
+	Counters end = ReadCounters();
+	cout << "Page allocations on the local node: " << end.local - start_.local
+		<< ", on other nodes: " << end.remote - start_.remote << endl;
+
+	// Ask the kernel for the node of every canvas page (move_pages
+	// without target nodes only queries) and compare it with the node
+	// of the worker that processes its rows.
+	const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t numThreads = min(NumThreads(), max<size_t>(image.rows, 1));
+	size_t local = 0, remote = 0, missing = 0;
+	for (size_t worker = 0; worker < numThreads; ++worker)
+	{
+		size_t beginRow = image.rows * worker / numThreads;
+		size_t endRow = image.rows * (worker + 1) / numThreads;
+		if (beginRow == endRow)
+			continue;
+		uintptr_t first = reinterpret_cast<uintptr_t>(image.ptr(static_cast<int>(beginRow)));
+		uintptr_t last = reinterpret_cast<uintptr_t>(image.ptr(static_cast<int>(endRow - 1)))
+			+ image.cols * image.elemSize();
+		vector<void*> pages;
+		for (uintptr_t page = first / pageSize * pageSize; page < last; page += pageSize)
+			pages.push_back(reinterpret_cast<void*>(page));
+		vector<int> status(pages.size(), -1);
+		if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr,
+					status.data(), 0) != 0)
+		{
+			cout << "Page placement unknown." << endl;
+			return;
+		}
+		int node = WorkerNode(worker);
+		for (int pageNode : status)
+		{
+			if (pageNode < 0)
+				++missing;
+			else if (pageNode == node)
+				++local;
+			else
+				++remote;
+		}
+	}
+	cout << "Canvas pages on the node of their worker: " << local
+		<< ", on other nodes: " << remote << ", not present: " << missing << endl;
+}
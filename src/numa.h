@@ -0,0 +1,95 @@
+#pragma once
+
+#include "common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <vector>
+
+// NUMA nodes and their cpus, read from /sys/devices/system/node.
+// Without that directory, all cpus count as one node.
+struct NumaTopology
+{
+	std::vector<std::vector<int>> nodeCpus; // The cpus of every node.
+	// The cpus this process may run on, grouped by node.
+	std::vector<int> usableCpus;
+	int NodeOf(int cpu) const;
+};
+
+// Read once on first use.
+const NumaTopology& Topology();
+
+// The cpu the worker thread with this index is pinned to. Neighbouring
+// workers, which process neighbouring ranges in ParallelFor, share a node.
+int WorkerCpu(std::size_t worker);
+
+// The node of WorkerCpu(worker), -1 if unknown.
+int WorkerNode(std::size_t worker);
+
+// Pins the calling thread to cpu. Returns false if that is not allowed.
+bool PinThread(int cpu);
+
+// Places the whole pages of [data, data + bytes) on node (mbind), with
+// move also the pages that are already present. Does nothing on single
+// node systems or for node -1.
+void BindToNode(void* data, std::size_t bytes, int node, bool move);
+
+// Like AllocateLarge, but on multi-node systems every block of at least
+// one page is mapped separately and bound to node before it is touched.
+void* AllocateOnNode(std::size_t bytes, int node);
+void FreeOnNode(void* data, std::size_t bytes, int node);
+
+// std allocator on top of AllocateOnNode, node -1 = no binding.
+template<class T>
+class NodeAllocator
+{
+public:
+	typedef T value_type;
+	explicit NodeAllocator(int node = -1) : node_(node) {}
+	template<class U> NodeAllocator(const NodeAllocator<U>& other) : node_(other.Node()) {}
+	int Node() const { return node_; }
+	T* allocate(std::size_t n)
+	{
+		if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+			throw std::bad_alloc();
+		return static_cast<T*>(AllocateOnNode(n * sizeof(T), node_));
+	}
+	void deallocate(T* data, std::size_t n)
+	{
+		FreeOnNode(data, n * sizeof(T), node_);
+	}
+private:
+	int node_;
+};
+
+template<class T, class U>
+bool operator==(const NodeAllocator<T>& a1, const NodeAllocator<U>& a2) { return a1.Node() == a2.Node(); }
+
+template<class T, class U>
+bool operator!=(const NodeAllocator<T>& a1, const NodeAllocator<U>& a2) { return !(a1 == a2); }
+
+// Like cv::Mat(size, type, value), but the rows of every range of
+// ParallelFor(size.height, ...) are bound to the node of its worker and
+// filled by it. So the pages are placed on the nodes of the workers that
+// later process these rows, in huge pages if possible.
+cv::Mat FirstTouchMat(cv::Size size, int type, const cv::Scalar& value);
+
+// Cross-node memory traffic for --numa. Compares the allocation counters
+// of the kernel (/sys/devices/system/node/node*/numastat) before and
+// after the run, and checks where the pages of the canvas ended up.
+class NumaReport
+{
+public:
+	NumaReport();
+	void Print(const cv::Mat& image) const;
+private:
+	struct Counters
+	{
+		std::uint64_t local; // Allocations on the node of the allocating cpu.
+		std::uint64_t remote;
+	};
+	static Counters ReadCounters();
+	Counters start_;
+};
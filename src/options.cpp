@@ -0,0 +1,316 @@
+#include "options.h"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+void PrintUsage()
+{
+	cout << "Usage: AllColors [2/3/4/imagePath] [options]" << endl
+		<< "  --engine=color/pixel/progressive/lookahead/warmstart/multifront" << endl
+		<< "  --pick=oldest/random/neighbours  (pixel engine only)" << endl
+		<< "  --size=WxH  (canvas size for 2/3/4 seed points)" << endl
+		<< "  --levels=N  (grow on a 2^N times smaller canvas first, then refine)" << endl
+		<< "  --target=imagePath  (approximate this image)" << endl
+		<< "  --target-weight=W  (0..1, blend of target and neighbourhood, 0 = full scan)" << endl
+		<< "  --palette=imagePath  (use the colors of this image)" << endl
+		<< "  --region=WxH+X+Y  (regrow this rectangle of the finished image imagePath)" << endl
+		<< "  --refine=N  (swap pixel colors after the growth, at most N passes)" << endl
+		<< "  --refine-seconds=S  (time budget of the refinement)" << endl
+		<< "  --analyze  (check the colors and smoothness of the finished image imagePath)" << endl
+		<< "  --symmetry=none/mirror-x/mirror-xy/rotational-4/dihedral-8" << endl
+		<< "  --quality=Q  (0..1, color engine speed vs. exactness, default 1)" << endl
+		<< "  --search=random/auto/linear/parallel  (exact search of the color engine)" << endl
+		<< "  --lookahead=K  (colors rated per scan by the lookahead engine)" << endl
+		<< "  --frontier-target=N  (color engine keeps the frontier below N)" << endl
+		<< "  --canvas-file=path  (out-of-core canvas for huge sizes, pixel engine)" << endl
+		<< "  --hot-tiles=N  (tiles of the out-of-core canvas kept in memory)" << endl
+		<< "  --tiff=path  (also write the final image as tiled BigTIFF)" << endl
+		<< "  --deep-zoom=path  (keep Deep Zoom tiles path.dzi up to date)" << endl
+		<< "  --preview-stream=path  (raw downscaled frames into this FIFO)" << endl
+		<< "  --preview-scale=N  (downscaling of the preview frames, up to 2048, default 4)" << endl
+#ifndef ALLCOLORS_NO_OPENCV
+		<< "  --preview  (live window, keys: p pause, r resume, s snapshot)" << endl
+#endif
+		<< "  --frame-ring=name  (publish the snapshots in POSIX shared memory)" << endl
+		<< "  --frame-ring-slots=N  (frames in the ring, default 8)" << endl
+		<< "  --frame-ring-policy=drop/block  (on slow readers, default drop)" << endl
+		<< "  --frame-ring-raw  (publish the canvas instead of the embellished image)" << endl
+		<< "  --numa  (report the NUMA topology and cross-node page traffic)" << endl
+		<< "  --huge-pages=on/off  (huge pages for the large arrays, default on)" << endl
+		<< "  --tlb  (report the data TLB misses of the run)" << endl;
+}
+
+bool StartsWith(const string& str, const string& prefix)
+{
+	return str.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Checks for an option of the form name=value.
+bool IsValueOption(const string& arg, const string& name, string& value)
+{
+	if (!StartsWith(arg, name + "="))
+		return false;
+	value = arg.substr(name.size() + 1);
+	return true;
+}
+
+bool ParseSize(const string& value, int& width, int& height)
+{
+	char x = 0;
+	istringstream ss(value);
+	return ss >> width >> x >> height && x == 'x' && ss.eof()
+		&& width > 0 && height > 0;
+}
+
+// Parses WxH+X+Y.
+bool ParseRegion(const string& value, Options& options)
+{
+	char x = 0, plus1 = 0, plus2 = 0;
+	istringstream ss(value);
+	return ss >> options.regionWidth >> x >> options.regionHeight
+		>> plus1 >> options.regionX >> plus2 >> options.regionY
+		&& x == 'x' && plus1 == '+' && plus2 == '+' && ss.eof()
+		&& options.regionWidth > 0 && options.regionHeight > 0
+		&& options.regionX >= 0 && options.regionY >= 0;
+}
+
+bool ParseInt(const string& value, int& result)
+{
+	istringstream ss(value);
+	return ss >> result && ss.eof();
+}
+
+bool ParseDouble(const string& value, double& result)
+{
+	istringstream ss(value);
+	return ss >> result && ss.eof();
+}
+
+bool ParseOption(const string& arg, Options& options)
+{
+	string value;
+	if (arg == "--engine=color")
+		options.engine = Engine::Color;
+	else if (arg == "--engine=pixel")
+		options.engine = Engine::Pixel;
+	else if (arg == "--engine=progressive")
+		options.engine = Engine::Progressive;
+	else if (arg == "--engine=lookahead")
+		options.engine = Engine::Lookahead;
+	else if (arg == "--engine=warmstart")
+		options.engine = Engine::WarmStart;
+	else if (arg == "--engine=multifront")
+		options.engine = Engine::MultiFront;
+	else if (arg == "--pick=oldest")
+		options.pick = PickRule::Oldest;
+	else if (arg == "--pick=random")
+		options.pick = PickRule::Random;
+	else if (arg == "--pick=neighbours")
+		options.pick = PickRule::Neighbours;
+	else if (IsValueOption(arg, "--size", value))
+		return ParseSize(value, options.width, options.height);
+	else if (IsValueOption(arg, "--levels", value))
+		return ParseInt(value, options.levels) && options.levels >= 0;
+	else if (arg == "--symmetry=none")
+		options.symmetry = Symmetry::None;
+	else if (arg == "--symmetry=mirror-x")
+		options.symmetry = Symmetry::MirrorX;
+	else if (arg == "--symmetry=mirror-xy")
+		options.symmetry = Symmetry::MirrorXY;
+	else if (arg == "--symmetry=rotational-4")
+		options.symmetry = Symmetry::Rotational4;
+	else if (arg == "--symmetry=dihedral-8")
+		options.symmetry = Symmetry::Dihedral8;
+	else if (IsValueOption(arg, "--quality", value))
+		return ParseDouble(value, options.quality)
+			&& options.quality >= 0 && options.quality <= 1;
+	else if (arg == "--search=random")
+		options.search = SearchMode::Random;
+	else if (arg == "--search=auto")
+		options.search = SearchMode::Auto;
+	else if (arg == "--search=linear")
+		options.search = SearchMode::Linear;
+	else if (arg == "--search=parallel")
+		options.search = SearchMode::Parallel;
+	else if (IsValueOption(arg, "--lookahead", value))
+		return ParseInt(value, options.lookahead) && options.lookahead > 0;
+	else if (IsValueOption(arg, "--frontier-target", value))
+	{
+		int target = 0;
+		if (!ParseInt(value, target) || target < 0)
+			return false;
+		options.frontierTarget = static_cast<size_t>(target);
+	}
+	else if (IsValueOption(arg, "--canvas-file", value))
+		options.canvasFile = value;
+	else if (IsValueOption(arg, "--hot-tiles", value))
+		return ParseInt(value, options.hotTiles) && options.hotTiles > 0;
+	else if (IsValueOption(arg, "--deep-zoom", value))
+		options.deepZoom = value;
+	else if (IsValueOption(arg, "--preview-stream", value))
+		options.previewStream = value;
+#ifndef ALLCOLORS_NO_OPENCV
+	else if (arg == "--preview")
+		options.previewWindow = true;
+#endif
+	else if (IsValueOption(arg, "--preview-scale", value))
+		return ParseInt(value, options.previewScale) && options.previewScale > 0
+			&& options.previewScale <= maxPreviewScale;
+	else if (IsValueOption(arg, "--frame-ring", value))
+		options.frameRing = value;
+	else if (IsValueOption(arg, "--frame-ring-slots", value))
+		return ParseInt(value, options.frameRingSlots) && options.frameRingSlots > 0;
+	else if (arg == "--frame-ring-policy=drop")
+		options.frameRingBlock = false;
+	else if (arg == "--frame-ring-policy=block")
+		options.frameRingBlock = true;
+	else if (arg == "--frame-ring-raw")
+		options.frameRingRaw = true;
+	else if (IsValueOption(arg, "--tiff", value))
+		options.tiff = value;
+	else if (arg == "--huge-pages=on")
+		options.hugePages = true;
+	else if (arg == "--huge-pages=off")
+		options.hugePages = false;
+	else if (arg == "--tlb")
+		options.tlbReport = true;
+	else if (arg == "--numa")
+		options.numaReport = true;
+	else if (IsValueOption(arg, "--refine", value))
+		return ParseInt(value, options.refinePasses) && options.refinePasses >= 0;
+	else if (IsValueOption(arg, "--refine-seconds", value))
+		return ParseDouble(value, options.refineSeconds) && options.refineSeconds >= 0;
+	else if (arg == "--analyze")
+		options.analyze = true;
+	else if (IsValueOption(arg, "--region", value))
+		return ParseRegion(value, options);
+	else if (IsValueOption(arg, "--palette", value))
+		options.palette = value;
+	else if (IsValueOption(arg, "--target", value))
+		options.target = value;
+	else if (IsValueOption(arg, "--target-weight", value))
+		return ParseDouble(value, options.targetWeight)
+			&& options.targetWeight >= 0 && options.targetWeight <= 1;
+	else
+		return false;
+	return true;
+}
+
+// Empty if the options select one well defined run, else why not.
+// Every mode runs its own engine, so the flags of the others would be
+// silently ignored.
+string CheckCombination(const Options& options)
+{
+	vector<string> modes;
+	if (options.analyze)
+		modes.push_back("--analyze");
+	if (!options.canvasFile.empty())
+		modes.push_back("--canvas-file");
+	if (options.regionWidth > 0)
+		modes.push_back("--region");
+	if (!options.target.empty())
+		modes.push_back("--target");
+	if (options.symmetry != Symmetry::None)
+		modes.push_back("--symmetry");
+	if (options.levels > 0)
+		modes.push_back("--levels");
+	if (modes.size() > 1)
+		return modes[0] + " cannot be combined with " + modes[1];
+	string mode = modes.empty() ? "" : modes[0];
+
+	// The out-of-core canvas is grown by the pixel engine, --region and
+	// --levels by the color engine, --target and --symmetry by their own.
+	if (!mode.empty() && options.engine != Engine::Color
+		&& !(mode == "--canvas-file" && options.engine == Engine::Pixel))
+		return "--engine cannot be combined with " + mode;
+	bool colorEngine = options.engine == Engine::Color
+		&& (mode.empty() || mode == "--levels" || mode == "--region");
+	string notColor = mode.empty() ? " needs --engine=color" : " cannot be combined with " + mode;
+	if (options.quality != 1 && !colorEngine)
+		return "--quality" + notColor;
+	if (options.search != SearchMode::Random && !colorEngine)
+		return "--search" + notColor;
+	if (options.frontierTarget > 0 && (!colorEngine || mode == "--region"))
+		return "--frontier-target" + notColor;
+	if (options.lookahead != Options().lookahead && options.engine != Engine::Lookahead)
+		return "--lookahead needs --engine=lookahead";
+	if (options.pick != PickRule::Oldest
+		&& options.engine != Engine::Pixel && mode != "--canvas-file")
+		return "--pick needs --engine=pixel";
+	if (options.targetWeight != Options().targetWeight && mode != "--target")
+		return "--target-weight needs --target";
+
+	// Used by the renderings set up in main(), which --region, --analyze
+	// and --canvas-file skip. The out-of-core rendering has its own
+	// support for some of them.
+	struct RunFlag
+	{
+		const char* name;
+		bool set;
+		bool outOfCore;
+	};
+	const Options defaults;
+	const RunFlag runFlags[] = {
+		{"--size", options.width != defaults.width || options.height != defaults.height, true},
+		{"--palette", !options.palette.empty(), true},
+		{"--tiff", !options.tiff.empty(), true},
+		{"--refine", options.refinePasses > 0 || options.refineSeconds > 0, false},
+		{"--deep-zoom", !options.deepZoom.empty(), false},
+		{"--preview-stream", !options.previewStream.empty(), false},
+		{"--preview", options.previewWindow, false},
+		{"--frame-ring", !options.frameRing.empty(), false},
+		{"--numa", options.numaReport, false},
+		{"--tlb", options.tlbReport, false}
+	};
+	if (mode == "--region" || mode == "--analyze" || mode == "--canvas-file")
+		for (const RunFlag& flag : runFlags)
+			if (flag.set && !(flag.outOfCore && mode == "--canvas-file"))
+				return flag.name + (" cannot be combined with " + mode);
+	if (options.hotTiles != defaults.hotTiles && mode != "--canvas-file")
+		return "--hot-tiles needs --canvas-file";
+	return "";
+}
+
+}
+
+bool ParseOptions(int argc, char *argv[], Options& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (StartsWith(arg, "--"))
+		{
+			if (!ParseOption(arg, options))
+			{
+				cout << "Invalid option: " << arg << endl;
+				PrintUsage();
+				return false;
+			}
+		}
+		else if (options.source.empty())
+			options.source = arg;
+		else
+		{
+			PrintUsage();
+			return false;
+		}
+	}
+	if (options.source.empty())
+	{
+		PrintUsage();
+		return false;
+	}
+	string conflict = CheckCombination(options);
+	if (!conflict.empty())
+	{
+		cout << "Invalid options: " << conflict << endl;
+		return false;
+	}
+	return true;
+}
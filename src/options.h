@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+enum class Engine
+{
+	Color, // Pop a color, search the whole frontier for its best position.
+	Pixel, // Pop a frontier pixel, search the palette for its best color.
+	Progressive, // Color engine, exact search pruned with cheap bounds.
+	Lookahead, // Color engine, exact search for the next colors at once.
+	WarmStart, // Color engine, exact search starting at the last placements.
+	MultiFront // One concurrent front per seed point with its own hue sector.
+};
+
+// How the pixel driven engine picks the next frontier pixel.
+enum class PickRule
+{
+	Oldest,
+	Random,
+	Neighbours
+};
+
+// Exact frontier search of the color engine.
+enum class SearchMode
+{
+	Random, // Single scan, ties are broken randomly.
+	Auto, // Linear or parallel scan, chosen by a calibrated cost model.
+	Linear, // Single scan, ties are broken by position.
+	Parallel // Scan on all cores, ties are broken by position.
+};
+
+enum class Symmetry
+{
+	None,
+	MirrorX,     // Mirrored at the vertical center line.
+	MirrorXY,    // Mirrored at both center lines.
+	Rotational4, // Rotated by 90 degrees, needs a square canvas.
+	Dihedral8    // Rotated and mirrored, needs a square canvas.
+};
+
+// 255 * maxPreviewScale^2, the sum of one preview texel, still fits an int.
+const int maxPreviewScale = 2048;
+
+struct Options
+{
+	Options() :
+		engine(Engine::Color), pick(PickRule::Oldest),
+		width(1920), height(1080), levels(0),
+		regionX(0), regionY(0), regionWidth(0), regionHeight(0), targetWeight(0.5),
+		symmetry(Symmetry::None), quality(1), search(SearchMode::Random),
+		lookahead(16), frontierTarget(0),
+		hotTiles(1024), previewScale(4), previewWindow(false),
+		frameRingSlots(8), frameRingBlock(false), frameRingRaw(false),
+		numaReport(false), hugePages(true), tlbReport(false), analyze(false),
+		refinePasses(0), refineSeconds(0)
+	{}
+	std::string source; // 2/3/4 seed points or path to a binary seed image.
+	Engine engine;
+	PickRule pick;
+	int width; // Canvas size for the fixed seed points.
+	int height;
+	int levels; // Number of coarser levels grown first, 0 = single level.
+	std::string target; // Optional path of an image to approximate.
+	std::string palette; // Optional image whose colors are used.
+	int regionX; // Rectangle of the finished image source to regrow,
+	int regionY; // regionWidth 0 = render a new image.
+	int regionWidth;
+	int regionHeight;
+	double targetWeight; // 0 = neighbourhood only, 1 = target only.
+	Symmetry symmetry;
+	double quality; // Color engine search, 0 = fast preview, 1 = exact.
+	SearchMode search;
+	int lookahead; // Number of colors the lookahead engine rates at once.
+	std::size_t frontierTarget; // Frontier size the color engine aims at, 0 = off.
+	std::string canvasFile; // Backing file of an out-of-core canvas, empty = in memory.
+	int hotTiles; // Tiles of the out-of-core canvas kept mapped.
+	std::string tiff; // Optional path of the final image as tiled BigTIFF.
+	std::string deepZoom; // Optional path of a live Deep Zoom pyramid.
+	std::string previewStream; // Optional FIFO for downscaled live frames.
+	int previewScale; // Downscaling of the preview frames.
+	bool previewWindow; // Show the growth live in a window.
+	std::string frameRing; // Optional shared memory name for the snapshots.
+	int frameRingSlots;
+	bool frameRingBlock; // Wait for slow readers instead of dropping frames.
+	bool frameRingRaw; // Publish the canvas instead of the embellished image.
+	bool numaReport; // Print the NUMA topology and cross-node traffic.
+	bool hugePages; // Back the large arrays with huge pages.
+	bool tlbReport; // Print the data TLB misses of the run.
+	bool analyze; // Print quality metrics of the finished image source.
+	int refinePasses; // Swap refinement after the growth, 0 = unlimited
+	double refineSeconds; // or off if both are 0.
+};
+
+// Returns false and prints the usage if the command line is invalid.
+bool ParseOptions(int argc, char *argv[], Options& options);
@@ -0,0 +1,250 @@
+#include "out_of_core.h"
+#include "init.h"
+#include "palette_index.h"
+#include "tiff_writer.h"
+
+#include <array>
+#include <cassert>
+#include <deque>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+const int previewSize = 2048;
+
+// Like PixelFrontier, but with a hashed membership instead of
+// canvas sized marker images.
+class TiledFrontier
+{
+public:
+	TiledFrontier(TiledCanvas& canvas, PickRule rule, mt19937& g) :
+		canvas_(canvas), rule_(rule), g_(g) {}
+	bool Empty() const { return members_.empty(); }
+	size_t Size() const { return members_.size(); }
+	void Push(const BigPos& pos);
+	BigPos Pop();
+	void Filled(const BigPos& pos);
+private:
+	int FilledCount(const BigPos& pos);
+	BigPos PopFromBuckets();
+	TiledCanvas& canvas_;
+	PickRule rule_;
+	mt19937& g_;
+	unordered_set<BigPos, BigPosHash> members_;
+	deque<BigPos> queue_;
+	vector<BigPos> pool_;
+	// Bucket queues by filled neighbour count, may contain stale entries.
+	array<deque<BigPos>, 9> buckets_;
+};
+
+// Number of already filled pixels in the 8-neighbourhood and their mean.
+int NeighbourhoodMean(TiledCanvas& canvas, const BigPos& pos, ColorDouble& mean)
+{
+	BigPosComponent x, y;
+	tie(x, y) = pos;
+	mean = ColorDouble(0, 0, 0);
+	int colorCount = 0;
+	for (BigPosComponent nx = x-spread; nx <= x+spread; ++nx)
+	{
+		for (BigPosComponent ny = y-spread; ny <= y+spread; ++ny)
+		{
+			if (!canvas.IsInside(nx, ny))
+				continue;
+			Color pixelColor = canvas.Get(nx, ny);
+			if (pixelColor[0] == invalidColor)
+				continue;
+			for (int c = 0; c < 3; ++c)
+				mean[c] += pixelColor[c];
+			++colorCount;
+		}
+	}
+	for (int c = 0; colorCount && c < 3; ++c)
+		mean[c] /= colorCount;
+	return colorCount;
+}
+
+int TiledFrontier::FilledCount(const BigPos& pos)
+{
+	ColorDouble unused;
+	return NeighbourhoodMean(canvas_, pos, unused);
+}
+
+void TiledFrontier::Push(const BigPos& pos)
+{
+	if (!members_.insert(pos).second)
+		return;
+	canvas_.Prefetch(pos);
+	switch (rule_)
+	{
+	case PickRule::Oldest:
+		queue_.push_back(pos);
+		break;
+	case PickRule::Random:
+		pool_.push_back(pos);
+		break;
+	case PickRule::Neighbours:
+		buckets_[FilledCount(pos)].push_back(pos);
+		break;
+	}
+}
+
+BigPos TiledFrontier::PopFromBuckets()
+{
+	for (int count = static_cast<int>(buckets_.size()) - 1; count >= 0; --count)
+	{
+		deque<BigPos>& bucket = buckets_[count];
+		while (!bucket.empty())
+		{
+			BigPos pos = bucket.front();
+			bucket.pop_front();
+			// The counts are not stored, an outdated entry has a lower one.
+			if (members_.count(pos) && FilledCount(pos) == count)
+				return pos;
+		}
+	}
+	assert(false); // Size and bucket contents are out of sync.
+	return BigPos();
+}
+
+BigPos TiledFrontier::Pop()
+{
+	assert(!Empty());
+	BigPos pos;
+	switch (rule_)
+	{
+	case PickRule::Oldest:
+		pos = queue_.front();
+		queue_.pop_front();
+		break;
+	case PickRule::Random:
+	{
+		size_t idx = uniform_int_distribution<size_t>(0, pool_.size() - 1)(g_);
+		pos = pool_[idx];
+		pool_[idx] = pool_.back();
+		pool_.pop_back();
+		break;
+	}
+	case PickRule::Neighbours:
+		pos = PopFromBuckets();
+		break;
+	}
+	members_.erase(pos);
+	return pos;
+}
+
+void TiledFrontier::Filled(const BigPos& pos)
+{
+	BigPosComponent x, y;
+	tie(x, y) = pos;
+	for (BigPosComponent nx = x-spread; nx <= x+spread; ++nx)
+	{
+		for (BigPosComponent ny = y-spread; ny <= y+spread; ++ny)
+		{
+			if (!canvas_.IsInside(nx, ny) || !canvas_.IsFree(nx, ny))
+				continue;
+			BigPos neighbour(nx, ny);
+			if (!members_.count(neighbour))
+				Push(neighbour);
+			else if (rule_ == PickRule::Neighbours)
+				buckets_[FilledCount(neighbour)].push_back(neighbour);
+		}
+	}
+}
+
+}
+
+void GrowOutOfCore(TiledCanvas& canvas, const set<BigPos>& initPositions,
+				   ColorRuns& colors, PickRule pick, mt19937& g,
+				   SnapshotWriter& snapshots)
+{
+	PaletteIndex palette(colors.Runs());
+	TiledFrontier frontier(canvas, pick, g);
+	for (const BigPos& pos : initPositions)
+		frontier.Push(pos);
+
+	while (!palette.Empty() && !frontier.Empty())
+	{
+		BigPos pos = frontier.Pop();
+		ColorDouble mean;
+		Color color;
+		if (NeighbourhoodMean(canvas, pos, mean))
+			color = palette.Nearest(mean);
+		else
+		{
+			// Colors taken by the index are dropped lazily from the hue queue.
+			while (!palette.Contains(colors.Back()))
+				colors.PopRun();
+			color = colors.Back();
+		}
+		palette.Remove(color);
+		canvas.Set(pos.first, pos.second, color);
+		frontier.Filled(pos);
+		if (snapshots.Due(palette.Size(), frontier.Size()))
+			snapshots.Write(canvas.Preview());
+	}
+}
+
+bool RenderOutOfCore(const Options& options)
+{
+	int num = NumSeedPoints(options.source);
+	if (!num)
+	{
+		cout << "The out-of-core canvas needs 2, 3 or 4 seed points." << endl;
+		return false;
+	}
+	TiledCanvas canvas(options.width, options.height, options.canvasFile,
+					   options.hotTiles, previewSize);
+	if (!canvas.Valid())
+		return false;
+
+	set<BigPos> initPositions;
+	const BigPosComponent plusLength = 5;
+	for (const pair<double, double>& point : SeedPoints(num))
+	{
+		BigPosComponent x = static_cast<BigPosComponent>(point.first*canvas.Width());
+		BigPosComponent y = static_cast<BigPosComponent>(point.second*canvas.Height());
+		for (BigPosComponent nx = x-plusLength; nx <= x+plusLength; ++nx)
+			if (canvas.IsInside(nx, y))
+				initPositions.insert(BigPos(nx, y));
+		for (BigPosComponent ny = y-plusLength; ny <= y+plusLength; ++ny)
+			if (canvas.IsInside(x, ny))
+				initPositions.insert(BigPos(x, ny));
+	}
+
+	mt19937 g(1);
+	// The palette is far smaller than such canvases, so every color is
+	// used several times to fill all of it.
+	const uint64_t numPixels = static_cast<uint64_t>(canvas.Width()) * canvas.Height();
+	ColorRuns colors = CoverArea(CreatePalette(options, g, static_cast<size_t>(numPixels)),
+								 numPixels);
+	if (colors.Empty())
+		return false;
+	SnapshotWriter snapshots(colors.Size());
+	try
+	{
+		GrowOutOfCore(canvas, initPositions, colors, options.pick, g, snapshots);
+		canvas.PrintStats();
+		if (!options.tiff.empty())
+		{
+			static_assert(TiledCanvas::tileSize == tiffTileSize, "Tiles are copied as a whole.");
+			return WriteTiledTiff(options.tiff, canvas.Width(), canvas.Height(),
+				[&](int64_t tileX, int64_t tileY, Channel* bgr)
+			{
+				canvas.CopyTile(tileX, tileY, bgr);
+			});
+		}
+		return canvas.WritePpm("./output/image.ppm");
+	}
+	catch (const runtime_error& e)
+	{
+		cout << e.what() << endl;
+		return false;
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "options.h"
+#include "output.h"
+#include "palette.h"
+#include "tiled_canvas.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+// The pixel driven engine (see GrowPixelDriven) on a TiledCanvas.
+// Its cost per step does not depend on the frontier size, and the
+// frontier only touches the tiles around the growth front.
+void GrowOutOfCore(TiledCanvas& canvas, const std::set<BigPos>& initPositions,
+				   ColorRuns& colors, PickRule pick,
+				   std::mt19937& g, SnapshotWriter& snapshots);
+
+// Renders options.width x options.height pixels from fixed seed points
+// into options.canvasFile. Snapshots are downscaled previews, the final
+// image is streamed into options.tiff or else ./output/image.ppm.
+bool RenderOutOfCore(const Options& options);
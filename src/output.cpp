@@ -0,0 +1,152 @@
+#include "output.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+#ifndef ALLCOLORS_NO_OPENCV
+
+Mat Embellish(const Mat& image)
+{
+	Mat ucharImg;
+	image.convertTo(ucharImg, CV_8UC3);
+
+	Mat filtered;
+	dilate(ucharImg, filtered, Mat(3, 3, CV_8UC1, Scalar(1)));
+	medianBlur(filtered, filtered, 3);
+
+	Mat ts;
+	vector<Mat> imageChans(3, Mat());
+	split(image, imageChans);
+	threshold(imageChans[0], ts, invalidColor, 1, THRESH_BINARY_INV);
+	Mat tu;
+	ts.convertTo(tu, CV_8UC1);
+	Mat tuchar;
+	cvtColor(tu, tuchar, COLOR_GRAY2BGR);
+
+	Mat m;
+	multiply(filtered, tuchar, m);
+
+	// fill black gaps, but only with half the median color.
+	Mat mixed;
+	addWeighted(ucharImg, 1.0, m, 0.5, 0.0, mixed);
+	return mixed;
+}
+
+#else
+
+// The same filters as above, without OpenCV.
+Mat Embellish(const Mat& image)
+{
+	// Dilate with a 3x3 rectangle (maximum per channel), separably.
+	Mat rowMax(image.size(), ImageType);
+	Mat dilated(image.size(), ImageType);
+	ParallelFor(image.rows, [&](size_t begin, size_t end)
+	{
+		for (PosComponent y = begin; y < static_cast<PosComponent>(end); ++y)
+		{
+			for (PosComponent x = 0; x < image.cols; ++x)
+			{
+				Color result = GetPixel(image, x, y);
+				for (PosComponent nx = max(x - 1, 0); nx <= min(x + 1, image.cols - 1); ++nx)
+					for (int c = 0; c < 3; ++c)
+						result[c] = max(result[c], GetPixel(image, nx, y)[c]);
+				SetPixel(rowMax, x, y, result);
+			}
+		}
+	});
+	ParallelFor(image.rows, [&](size_t begin, size_t end)
+	{
+		for (PosComponent y = begin; y < static_cast<PosComponent>(end); ++y)
+		{
+			for (PosComponent x = 0; x < image.cols; ++x)
+			{
+				Color result = GetPixel(rowMax, x, y);
+				for (PosComponent ny = max(y - 1, 0); ny <= min(y + 1, image.rows - 1); ++ny)
+					for (int c = 0; c < 3; ++c)
+						result[c] = max(result[c], GetPixel(rowMax, x, ny)[c]);
+				SetPixel(dilated, x, y, result);
+			}
+		}
+	});
+
+	// Fill black gaps, but only with half the 3x3 median
+	// (borders replicated) of the dilated colors.
+	Mat mixed = image.clone();
+	ParallelFor(image.rows, [&](size_t begin, size_t end)
+	{
+		Channel window[9];
+		for (PosComponent y = begin; y < static_cast<PosComponent>(end); ++y)
+		{
+			for (PosComponent x = 0; x < image.cols; ++x)
+			{
+				if (!IsFree(image, x, y))
+					continue;
+				Color color = GetPixel(image, x, y);
+				for (int c = 0; c < 3; ++c)
+				{
+					int n = 0;
+					for (PosComponent dy = -1; dy <= 1; ++dy)
+						for (PosComponent dx = -1; dx <= 1; ++dx)
+							window[n++] = GetPixel(dilated,
+								min(max(x + dx, 0), image.cols - 1),
+								min(max(y + dy, 0), image.rows - 1))[c];
+					nth_element(window, window + 4, window + 9);
+					// Rounded half to even, like cv::addWeighted.
+					long value = lrint(color[c] + 0.5 * window[4]);
+					color[c] = static_cast<Channel>(min(value, 255L));
+				}
+				SetPixel(mixed, x, y, color);
+			}
+		}
+	});
+	return mixed;
+}
+
+#endif
+
+SnapshotWriter::SnapshotWriter(size_t numColors, const string& prefix) :
+	prefix_(prefix),
+	maxSaves_(numColors / saveEveryNFrames),
+	lastColorsLeft_(numColors),
+	imgNum_(0)
+{
+}
+
+void SnapshotWriter::Update(const Mat& image, size_t colorsLeft,
+							size_t frontierSize)
+{
+	if (Due(colorsLeft, frontierSize))
+		Write(image);
+}
+
+bool SnapshotWriter::Due(size_t colorsLeft, size_t frontierSize)
+{
+	// Save whenever a multiple of saveEveryNFrames has been reached.
+	auto section = [](size_t colors) -> size_t
+	{
+		return (colors + saveEveryNFrames - 1) / saveEveryNFrames;
+	};
+	bool save = section(colorsLeft) != section(lastColorsLeft_);
+	lastColorsLeft_ = colorsLeft;
+	if (save)
+		cout << imgNum_ + 1 << "/" << maxSaves_ << " " << colorsLeft << " " << frontierSize << endl;
+	return save;
+}
+
+void SnapshotWriter::Write(const Mat& image)
+{
+	stringstream ss;
+	ss << setw(4) << setfill('0') << ++imgNum_;
+	Mat outImage = Embellish(image);
+	imwrite(prefix_ + ss.str() + ".png", outImage);
+	for (PlacementListener* listener : listeners_)
+		listener->Snapshot(image, outImage);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Fills the black gaps of the canvas with half the color of the
+// median filtered, dilated canvas, which smoothes borders and gaps.
+cv::Mat Embellish(const cv::Mat& image);
+
+// Follows the canvas, see SnapshotWriter::AddListener.
+class PlacementListener
+{
+public:
+	virtual ~PlacementListener() {}
+	// Called for every pixel set on the canvas.
+	virtual void Placed(const Pos& pos, const Color& color) = 0;
+	// Called when the color of an already filled pixel changes.
+	virtual void Replaced(const Pos& pos, const Color& oldColor, const Color& color) = 0;
+	// Called with every snapshot, the canvas and its embellished version.
+	virtual void Snapshot(const cv::Mat& /*image*/, const cv::Mat& /*embellished*/) {}
+};
+
+// Writes an embellished snapshot of the canvas every saveEveryNFrames colors.
+// Engines that place several colors at once may skip over the multiples.
+class SnapshotWriter
+{
+public:
+	explicit SnapshotWriter(std::size_t numColors,
+							const std::string& prefix = "./output/image");
+	// Forwards the placements and snapshots to listener.
+	void AddListener(PlacementListener* listener) { listeners_.push_back(listener); }
+	// Called for every pixel set on the canvas.
+	void Placed(const Pos& pos, const Color& color)
+	{
+		for (PlacementListener* listener : listeners_)
+			listener->Placed(pos, color);
+	}
+	// Called when the color of an already filled pixel changes.
+	void Replaced(const Pos& pos, const Color& oldColor, const Color& color)
+	{
+		for (PlacementListener* listener : listeners_)
+			listener->Replaced(pos, oldColor, color);
+	}
+	// Called after every placement with the number of colors still to place.
+	void Update(const cv::Mat& image, std::size_t colorsLeft,
+				std::size_t frontierSize);
+	// Like Update, but only reports whether a snapshot is due, for canvases
+	// that have to be rendered into an image first.
+	bool Due(std::size_t colorsLeft, std::size_t frontierSize);
+	// Unconditionally writes the next snapshot.
+	void Write(const cv::Mat& image);
+private:
+	static const std::size_t saveEveryNFrames = 512;
+	std::string prefix_;
+	std::size_t maxSaves_;
+	std::size_t lastColorsLeft_;
+	unsigned long long imgNum_;
+	std::vector<PlacementListener*> listeners_;
+};
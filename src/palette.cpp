@@ -0,0 +1,179 @@
+#include "palette.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+using namespace cv;
+using namespace std;
+
+ColorRuns::ColorRuns(const vector<Color>& colors) :
+	size_(colors.size())
+{
+	for (const Color& color : colors)
+	{
+		if (!runs_.empty() && runs_.back().color == color)
+			++runs_.back().count;
+		else
+			runs_.push_back(Run{color, 1});
+	}
+}
+
+ColorRuns::ColorRuns(const vector<Run>& runs) :
+	runs_(runs.begin(), runs.end()),
+	size_(0)
+{
+	runs_.erase(remove_if(runs_.begin(), runs_.end(),
+		[](const Run& run) { return run.count == 0; }), runs_.end());
+	for (const Run& run : runs_)
+		size_ += run.count;
+}
+
+void ColorRuns::PopBack()
+{
+	assert(!Empty());
+	--size_;
+	if (!--runs_.back().count)
+		runs_.pop_back();
+}
+
+void ColorRuns::PopRun()
+{
+	assert(!Empty());
+	size_ -= runs_.back().count;
+	runs_.pop_back();
+}
+
+vector<Color> ColorRuns::Expand() const
+{
+	vector<Color> colors;
+	colors.reserve(size_);
+	for (const Run& run : runs_)
+		colors.insert(colors.end(), run.count, run.color);
+	return colors;
+}
+
+vector<ColorRuns::Run> ColorHistogram(const Mat& image)
+{
+	// Every thread sorts the keys of its rows and counts them, so the
+	// threads share no bins. The sorted parts are merged at the end.
+	typedef pair<uint32_t, uint32_t> KeyCount;
+	vector<vector<KeyCount>> parts(NumThreads());
+	atomic<size_t> nextPart(0);
+	ParallelFor(image.rows, [&](size_t begin, size_t end)
+	{
+		vector<uint32_t> keys((end - begin) * image.cols);
+		uint32_t* key = keys.data();
+		for (size_t y = begin; y < end; ++y)
+		{
+			// Branch free packing, which the compiler vectorizes.
+			const Channel* row = image.ptr<Channel>(static_cast<int>(y));
+			for (int x = 0; x < image.cols; ++x)
+			{
+				uint32_t b = row[3*x] | (row[3*x] == invalidColor);
+				key[x] = b << 16 | uint32_t(row[3*x + 1]) << 8 | row[3*x + 2];
+			}
+			key += image.cols;
+		}
+		sort(keys.begin(), keys.end());
+		vector<KeyCount>& part = parts[nextPart++];
+		for (uint32_t k : keys)
+		{
+			if (!part.empty() && part.back().first == k)
+				++part.back().second;
+			else
+				part.push_back(KeyCount(k, 1));
+		}
+	});
+
+	vector<KeyCount> merged;
+	for (const vector<KeyCount>& part : parts)
+	{
+		size_t middle = merged.size();
+		merged.insert(merged.end(), part.begin(), part.end());
+		inplace_merge(merged.begin(), merged.begin() + middle, merged.end());
+	}
+	vector<ColorRuns::Run> histogram;
+	for (size_t i = 0; i < merged.size(); ++i)
+	{
+		uint32_t key = merged[i].first;
+		if (i > 0 && merged[i - 1].first == key)
+			histogram.back().count += merged[i].second;
+		else
+			histogram.push_back(ColorRuns::Run{Color(key >> 16, (key >> 8) & 0xFF, key & 0xFF),
+											   merged[i].second});
+	}
+	return histogram;
+}
+
+ColorRuns CoverArea(const ColorRuns& palette, uint64_t numPixels)
+{
+	const uint64_t size = palette.Size();
+	if (size == 0 || size >= numPixels)
+		return palette;
+	// Run i covers [first, last) of the palette, and of the result
+	// [first * numPixels / size, last * numPixels / size).
+	vector<ColorRuns::Run> runs;
+	runs.reserve(palette.Runs().size());
+	uint64_t first = 0;
+	for (const ColorRuns::Run& run : palette.Runs())
+	{
+		uint64_t last = first + run.count;
+		uint64_t count = last * numPixels / size - first * numPixels / size;
+		if (count > numeric_limits<uint32_t>::max())
+		{
+			cout << "The palette has too few colors to cover " << numPixels << " pixels." << endl;
+			return ColorRuns();
+		}
+		runs.push_back(ColorRuns::Run{run.color, static_cast<uint32_t>(count)});
+		first = last;
+	}
+	return ColorRuns(runs);
+}
+
+ColorRuns PaletteFromImage(const string& path, mt19937& g, size_t maxColors)
+{
+	Mat image = imread(path, IMREAD_COLOR);
+	if (!image.rows)
+	{
+		cout << "Could not load " << path << endl;
+		return ColorRuns();
+	}
+	vector<ColorRuns::Run> runs = ColorHistogram(image);
+	cout << "Palette: " << runs.size() << " colors in " << image.total() << " pixels" << endl;
+
+	// Largest remainder scaling keeps the proportions and the exact total.
+	if (image.total() > maxColors)
+	{
+		vector<double> remainders(runs.size());
+		size_t total = 0;
+		for (size_t i = 0; i < runs.size(); ++i)
+		{
+			double scaled = double(runs[i].count) * maxColors / image.total();
+			runs[i].count = static_cast<uint32_t>(scaled);
+			remainders[i] = scaled - runs[i].count;
+			total += runs[i].count;
+		}
+		vector<size_t> order(runs.size());
+		iota(order.begin(), order.end(), 0);
+		sort(order.begin(), order.end(), [&](size_t i1, size_t i2)
+		{
+			return remainders[i1] > remainders[i2];
+		});
+		for (size_t i = 0; total < maxColors && i < order.size(); ++i, ++total)
+			++runs[order[i]].count;
+	}
+
+	// Same order as the cube palette, shuffled and sorted by hue.
+	shuffle(runs.begin(), runs.end(), g);
+	sort(runs.begin(), runs.end(), [](const ColorRuns::Run& run1, const ColorRuns::Run& run2)
+	{
+		return bgr2hsv(run1.color)[0] < bgr2hsv(run2.color)[0];
+	});
+	return ColorRuns(runs);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.h"
+#include "huge_pages.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Colors with multiplicities, stored as runs of equal colors in queue order.
+// Used like a vector<Color> that is popped from the back, but duplicates
+// cost no memory.
+class ColorRuns
+{
+public:
+	struct Run
+	{
+		Color color;
+		std::uint32_t count;
+	};
+	typedef std::vector<Run, HugePageAllocator<Run>> RunVector;
+	ColorRuns() : size_(0) {}
+	explicit ColorRuns(const std::vector<Color>& colors);
+	explicit ColorRuns(const std::vector<Run>& runs);
+	bool Empty() const { return size_ == 0; }
+	std::size_t Size() const { return size_; }
+	const Color& Back() const { return runs_.back().color; }
+	// Removes one color from the back.
+	void PopBack();
+	// Removes all remaining duplicates of the back color.
+	void PopRun();
+	const RunVector& Runs() const { return runs_; }
+	// For the engines working on a plain color list.
+	std::vector<Color> Expand() const;
+private:
+	RunVector runs_;
+	std::size_t size_;
+};
+
+// (color, count) table of all colors of the image, built on all cores.
+// A blue channel of 0 is raised to 1, since it marks empty canvas pixels.
+std::vector<ColorRuns::Run> ColorHistogram(const cv::Mat& image);
+
+// Repeats the colors of palette, in their order and in proportion to their
+// counts, so they add up to exactly numPixels. Unchanged if the palette
+// is already large enough, empty (with a message) if a count would overflow.
+ColorRuns CoverArea(const ColorRuns& palette, std::uint64_t numPixels);
+
+// The colors of the image at path with their multiplicities, sorted by hue.
+// If it has more than maxColors pixels, the counts are scaled down
+// proportionally. Empty if the image could not be loaded.
+ColorRuns PaletteFromImage(const std::string& path, std::mt19937& g,
+						   std::size_t maxColors);
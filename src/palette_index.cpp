@@ -0,0 +1,94 @@
+#include "palette_index.h"
+
+#include <cassert>
+#include <limits>
+
+using namespace cv;
+using namespace std;
+
+PaletteIndex::PaletteIndex(const vector<Color>& colors) :
+	PaletteIndex(ColorRuns(colors).Runs())
+{
+}
+
+PaletteIndex::PaletteIndex(const ColorRuns::RunVector& runs) :
+	cells_(Grid::numCells),
+	size_(0)
+{
+	for (const ColorRuns::Run& run : runs)
+	{
+		Cell& cell = cells_[Grid::CellIndex(run.color)];
+		cell.live += run.count;
+		size_ += run.count;
+		auto it = find_if(cell.entries.begin(), cell.entries.end(),
+			[&](const Entry& entry) { return entry.color == run.color; });
+		if (it != cell.entries.end())
+			it->count += run.count;
+		else
+			cell.entries.push_back(Entry{run.color, run.count});
+	}
+}
+
+bool PaletteIndex::Contains(const Color& color) const
+{
+	const Cell& cell = cells_[Grid::CellIndex(color)];
+	return any_of(cell.entries.begin(), cell.entries.end(),
+		[&](const Entry& entry) { return entry.count && entry.color == color; });
+}
+
+void PaletteIndex::ScanCell(size_t cellIdx, const ColorDouble& query,
+							double& bestDistSq, Color& bestColor) const
+{
+	const Cell& cell = cells_[cellIdx];
+	if (!cell.live)
+		return;
+	for (const Entry& entry : cell.entries)
+	{
+		if (!entry.count)
+			continue;
+		double db = entry.color[0] - query[0];
+		double dg = entry.color[1] - query[1];
+		double dr = entry.color[2] - query[2];
+		double distSq = db*db + dg*dg + dr*dr;
+		if (distSq < bestDistSq)
+		{
+			bestDistSq = distSq;
+			bestColor = entry.color;
+		}
+	}
+}
+
+Color PaletteIndex::Nearest(const ColorDouble& query) const
+{
+	assert(!Empty());
+	double bestDistSq = numeric_limits<double>::infinity();
+	Color bestColor;
+	Grid::VisitShells(query, [&](size_t cellIdx)
+	{
+		ScanCell(cellIdx, query, bestDistSq, bestColor);
+	}, [&](double bound) -> bool
+	{
+		return bound * bound >= bestDistSq;
+	});
+	return bestColor;
+}
+
+void PaletteIndex::Remove(const Color& color)
+{
+	Cell& cell = cells_[Grid::CellIndex(color)];
+	auto it = find_if(cell.entries.begin(), cell.entries.end(),
+		[&](const Entry& entry) { return entry.count && entry.color == color; });
+	assert(it != cell.entries.end());
+	--size_;
+	--cell.live;
+	if (--it->count)
+		return;
+	// Compact the cell once the tombstones dominate it.
+	if (++cell.dead * 2 > cell.entries.size())
+	{
+		cell.entries.erase(remove_if(cell.entries.begin(), cell.entries.end(),
+			[](const Entry& entry) { return entry.count == 0; }),
+			cell.entries.end());
+		cell.dead = 0;
+	}
+}
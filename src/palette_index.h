@@ -0,0 +1,46 @@
+#pragma once
+
+#include "color_grid.h"
+#include "common.h"
+#include "palette.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Remaining palette colors in a 3D bucket grid over the RGB cube.
+// Removed colors are only tombstoned (count 0) and a cell is compacted
+// once most of its entries are dead, so removal stays O(cell size).
+// Nearest neighbour queries visit the cells in growing shells around
+// the query and stop as soon as no closer cell can exist.
+class PaletteIndex
+{
+public:
+	explicit PaletteIndex(const std::vector<Color>& colors);
+	explicit PaletteIndex(const ColorRuns::RunVector& runs);
+	std::size_t Size() const { return size_; }
+	bool Empty() const { return size_ == 0; }
+	bool Contains(const Color& color) const;
+	// Nearest remaining color (euclidean RGB). Must not be called if empty.
+	Color Nearest(const ColorDouble& query) const;
+	// Removes one occurrence of color, which must be contained.
+	void Remove(const Color& color);
+private:
+	struct Entry
+	{
+		Color color;
+		std::uint32_t count;
+	};
+	struct Cell
+	{
+		Cell() : live(0), dead(0) {}
+		std::vector<Entry> entries;
+		std::size_t live;
+		std::size_t dead;
+	};
+	typedef ColorGrid<3> Grid;
+	void ScanCell(std::size_t cellIdx, const ColorDouble& query,
+				  double& bestDistSq, Color& bestColor) const;
+	std::vector<Cell> cells_;
+	std::size_t size_;
+};
@@ -0,0 +1,125 @@
+#include "parallel.h"
+#include "numa.h"
+#include "perf_counter.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+thread_local bool isWorker = false;
+
+// Threads of ParallelFor. They are started and pinned on first use and
+// then wait for the next call, so a call costs a wakeup, not a thread start.
+class WorkerPool
+{
+public:
+	static WorkerPool& Instance()
+	{
+		static WorkerPool pool;
+		return pool;
+	}
+	~WorkerPool();
+	void Run(size_t numWorkers, size_t n, const function<void(size_t, size_t)>& body);
+private:
+	WorkerPool() : body_(nullptr), n_(0), numWorkers_(0), generation_(0),
+		pending_(0), stop_(false) {}
+	void Work(size_t index, unsigned long long seen);
+	mutex callMutex_; // One call at a time.
+	mutex mutex_;
+	condition_variable start_;
+	condition_variable done_;
+	vector<thread> threads_;
+	const function<void(size_t, size_t)>* body_;
+	size_t n_;
+	size_t numWorkers_;
+	unsigned long long generation_;
+	size_t pending_;
+	bool stop_;
+};
+
+WorkerPool::~WorkerPool()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		stop_ = true;
+	}
+	start_.notify_all();
+	for (thread& t : threads_)
+		t.join();
+}
+
+void WorkerPool::Run(size_t numWorkers, size_t n,
+					 const function<void(size_t, size_t)>& body)
+{
+	lock_guard<mutex> call(callMutex_);
+	unique_lock<mutex> lock(mutex_);
+	while (threads_.size() < numWorkers)
+		threads_.emplace_back(&WorkerPool::Work, this, threads_.size(), generation_);
+	body_ = &body;
+	n_ = n;
+	numWorkers_ = numWorkers;
+	pending_ = numWorkers;
+	++generation_;
+	start_.notify_all();
+	done_.wait(lock, [this]() { return pending_ == 0; });
+	body_ = nullptr;
+}
+
+void WorkerPool::Work(size_t index, unsigned long long seen)
+{
+	isWorker = true;
+	PinThread(WorkerCpu(index));
+	// The workers only exit at the end, an inherited counter would miss them.
+	RegisterPerfThread();
+	unique_lock<mutex> lock(mutex_);
+	for (;;)
+	{
+		start_.wait(lock, [this, seen]() { return stop_ || generation_ != seen; });
+		if (stop_)
+		{
+			UnregisterPerfThread();
+			return;
+		}
+		seen = generation_;
+		if (index >= numWorkers_)
+			continue;
+		size_t begin = n_ * index / numWorkers_;
+		size_t end = n_ * (index + 1) / numWorkers_;
+		const function<void(size_t, size_t)>& body = *body_;
+		lock.unlock();
+		body(begin, end);
+		lock.lock();
+		if (--pending_ == 0)
+			done_.notify_one();
+	}
+}
+
+}
+
+size_t NumThreads()
+{
+	// One worker per cpu this process may use (taskset, cpuset cgroups).
+	size_t usable = Topology().usableCpus.size();
+	if (usable > 0)
+		return usable;
+	return max<size_t>(thread::hardware_concurrency(), 1);
+}
+
+void ParallelFor(size_t n, const function<void(size_t, size_t)>& body)
+{
+	size_t numThreads = min(NumThreads(), max<size_t>(n, 1));
+	// A body calling ParallelFor again runs its loop on its own thread.
+	if (numThreads == 1 || isWorker)
+	{
+		body(0, n);
+		return;
+	}
+	WorkerPool::Instance().Run(numThreads, n, body);
+}
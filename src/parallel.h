@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// Number of worker threads used by the parallel stages, one per cpu
+// the process may run on.
+std::size_t NumThreads();
+
+// Splits [0, n) into one contiguous range per worker thread
+// and calls body(begin, end) for each of them concurrently.
+// Worker i always runs on the cpu WorkerCpu(i), so memory first
+// touched for a range stays local to the node processing it.
+// The workers are started once and reused by all calls; calls from
+// several threads run one after another, nested calls run serially.
+void ParallelFor(std::size_t n,
+				 const std::function<void(std::size_t, std::size_t)>& body);
@@ -0,0 +1,117 @@
+#include "perf_counter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+
+// Guards the registry and the threadFds_ of all counters.
+mutex registryMutex;
+vector<pid_t> registeredThreads;
+vector<PerfCounter*> liveCounters;
+
+pid_t ThisThread()
+{
+	return static_cast<pid_t>(syscall(SYS_gettid));
+}
+
+// Counter of thread tid, or with inherit of the calling thread and the
+// threads it creates later.
+int OpenCounter(PerfEvent event, pid_t tid, bool inherit)
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	if (event == PerfEvent::Cycles)
+	{
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	}
+	else
+	{
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = PERF_COUNT_HW_CACHE_DTLB |
+			(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	}
+	attr.inherit = inherit ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+}
+
+uint64_t ReadCounter(int fd)
+{
+	uint64_t count = 0;
+	if (read(fd, &count, sizeof(count)) != sizeof(count))
+		return 0;
+	return count;
+}
+
+}
+
+PerfCounter::PerfCounter(PerfEvent event) : event_(event)
+{
+	fd_ = OpenCounter(event, 0, true);
+	if (fd_ < 0)
+		return;
+	lock_guard<mutex> lock(registryMutex);
+	for (pid_t tid : registeredThreads)
+	{
+		int fd = OpenCounter(event, tid, false);
+		if (fd >= 0)
+			threadFds_.push_back(fd);
+	}
+	liveCounters.push_back(this);
+}
+
+PerfCounter::~PerfCounter()
+{
+	if (fd_ < 0)
+		return;
+	lock_guard<mutex> lock(registryMutex);
+	liveCounters.erase(find(liveCounters.begin(), liveCounters.end(), this));
+	for (int fd : threadFds_)
+		close(fd);
+	close(fd_);
+}
+
+uint64_t PerfCounter::Value() const
+{
+	if (fd_ < 0)
+		return 0;
+	uint64_t count = ReadCounter(fd_);
+	lock_guard<mutex> lock(registryMutex);
+	for (int fd : threadFds_)
+		count += ReadCounter(fd);
+	return count;
+}
+
+void RegisterPerfThread()
+{
+	pid_t tid = ThisThread();
+	lock_guard<mutex> lock(registryMutex);
+	registeredThreads.push_back(tid);
+	for (PerfCounter* counter : liveCounters)
+	{
+		int fd = OpenCounter(counter->event_, tid, false);
+		if (fd >= 0)
+			counter->threadFds_.push_back(fd);
+	}
+}
+
+void UnregisterPerfThread()
+{
+	pid_t tid = ThisThread();
+	lock_guard<mutex> lock(registryMutex);
+	registeredThreads.erase(remove(registeredThreads.begin(), registeredThreads.end(), tid),
+							registeredThreads.end());
+}
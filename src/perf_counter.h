@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class PerfEvent
+{
+	Cycles, // CPU cycles in user space.
+	DtlbLoadMisses // Data TLB load misses.
+};
+
+// Hardware event counter of this process, read through perf_event_open.
+// Threads registered with RegisterPerfThread, e.g. the ParallelFor
+// workers, are counted as they run, other threads created later only
+// once they have finished. Not available on every system (see
+// /proc/sys/kernel/perf_event_paranoid), then Valid() is false.
+class PerfCounter
+{
+public:
+	explicit PerfCounter(PerfEvent event);
+	~PerfCounter();
+	PerfCounter(const PerfCounter&) = delete;
+	PerfCounter& operator=(const PerfCounter&) = delete;
+	bool Valid() const { return fd_ >= 0; }
+	// Events since the construction, 0 if not Valid().
+	std::uint64_t Value() const;
+private:
+	friend void RegisterPerfThread();
+	PerfEvent event_;
+	int fd_;
+	std::vector<int> threadFds_; // One per registered thread.
+};
+
+// Makes every PerfCounter, existing or created later, count the calling
+// long-lived thread while it runs. UnregisterPerfThread before it exits.
+void RegisterPerfThread();
+void UnregisterPerfThread();
@@ -0,0 +1,173 @@
+#include "pixel_engine.h"
+#include "palette_index.h"
+
+#include <cassert>
+
+using namespace cv;
+using namespace std;
+
+PixelFrontier::PixelFrontier(const Mat& image, PickRule rule, mt19937& g) :
+	image_(image),
+	rule_(rule),
+	g_(g),
+	inFrontier_(image.size(), CV_8UC1, Scalar_<unsigned char>(0)),
+	filledNeighbours_(image.size(), CV_8UC1, Scalar_<unsigned char>(0)),
+	size_(0)
+{
+}
+
+void PixelFrontier::PushToBucket(const Pos& pos)
+{
+	unsigned char count = filledNeighbours_.at<unsigned char>(pos.second, pos.first);
+	buckets_[count].push_back(pos);
+}
+
+Pos PixelFrontier::PopFromBuckets()
+{
+	for (int count = static_cast<int>(buckets_.size()) - 1; count >= 0; --count)
+	{
+		deque<Pos>& bucket = buckets_[count];
+		while (!bucket.empty())
+		{
+			Pos pos = bucket.front();
+			bucket.pop_front();
+			bool stale = !inFrontier_.at<unsigned char>(pos.second, pos.first) ||
+				filledNeighbours_.at<unsigned char>(pos.second, pos.first) != count;
+			if (!stale)
+				return pos;
+		}
+	}
+	assert(false); // Size and bucket contents are out of sync.
+	return Pos();
+}
+
+void PixelFrontier::Push(const Pos& pos)
+{
+	unsigned char& inFrontier = inFrontier_.at<unsigned char>(pos.second, pos.first);
+	if (inFrontier)
+		return;
+	inFrontier = 1;
+	++size_;
+	switch (rule_)
+	{
+	case PickRule::Oldest:
+		queue_.push_back(pos);
+		break;
+	case PickRule::Random:
+		pool_.push_back(pos);
+		break;
+	case PickRule::Neighbours:
+	{
+		ColorDouble unused;
+		filledNeighbours_.at<unsigned char>(pos.second, pos.first) =
+			static_cast<unsigned char>(NeighbourhoodMean(image_, pos, unused));
+		PushToBucket(pos);
+		break;
+	}
+	}
+}
+
+Pos PixelFrontier::Pop()
+{
+	assert(!Empty());
+	Pos pos;
+	switch (rule_)
+	{
+	case PickRule::Oldest:
+		pos = queue_.front();
+		queue_.pop_front();
+		break;
+	case PickRule::Random:
+	{
+		size_t idx = uniform_int_distribution<size_t>(0, pool_.size() - 1)(g_);
+		pos = pool_[idx];
+		pool_[idx] = pool_.back();
+		pool_.pop_back();
+		break;
+	}
+	case PickRule::Neighbours:
+		pos = PopFromBuckets();
+		break;
+	}
+	inFrontier_.at<unsigned char>(pos.second, pos.first) = 0;
+	--size_;
+	return pos;
+}
+
+void PixelFrontier::Filled(const Pos& pos)
+{
+	PosComponent x, y;
+	tie(x, y) = pos;
+	for (PosComponent nx = x-spread; nx <= x+spread; ++nx)
+	{
+		for (PosComponent ny = y-spread; ny <= y+spread; ++ny)
+		{
+			if (!IsInside(image_, nx, ny) || !IsFree(image_, nx, ny))
+				continue;
+			Pos neighbour(nx, ny);
+			if (!inFrontier_.at<unsigned char>(ny, nx))
+			{
+				Push(neighbour);
+				continue;
+			}
+			if (rule_ != PickRule::Neighbours)
+				continue;
+			++filledNeighbours_.at<unsigned char>(ny, nx);
+			PushToBucket(neighbour);
+		}
+	}
+}
+
+int NeighbourhoodMean(const Mat& image, Pos pos, ColorDouble& mean)
+{
+	PosComponent x, y;
+	tie(x, y) = pos;
+	mean = ColorDouble(0, 0, 0);
+	int colorCount = 0;
+	for (PosComponent nx = x-spread; nx <= x+spread; ++nx)
+	{
+		for (PosComponent ny = y-spread; ny <= y+spread; ++ny)
+		{
+			if (!IsInside(image, nx, ny) || IsFree(image, nx, ny))
+				continue;
+			Color pixelColor = GetPixel(image, nx, ny);
+			for (int c = 0; c < 3; ++c)
+				mean[c] += pixelColor[c];
+			++colorCount;
+		}
+	}
+	for (int c = 0; colorCount && c < 3; ++c)
+		mean[c] /= colorCount;
+	return colorCount;
+}
+
+void GrowPixelDriven(Mat& image, const set<Pos>& initPositions,
+					 ColorRuns& colors, PickRule pick, mt19937& g,
+					 SnapshotWriter& snapshots)
+{
+	PaletteIndex palette(colors.Runs());
+	PixelFrontier frontier(image, pick, g);
+	for (const Pos& pos : initPositions)
+		frontier.Push(pos);
+
+	while (!palette.Empty() && !frontier.Empty())
+	{
+		Pos pos = frontier.Pop();
+		ColorDouble mean;
+		Color color;
+		if (NeighbourhoodMean(image, pos, mean))
+			color = palette.Nearest(mean);
+		else
+		{
+			// Colors taken by the index are dropped lazily from the hue queue.
+			while (!palette.Contains(colors.Back()))
+				colors.PopRun();
+			color = colors.Back();
+		}
+		palette.Remove(color);
+		SetPixel(image, pos.first, pos.second, color);
+		snapshots.Placed(pos, color);
+		frontier.Filled(pos);
+		snapshots.Update(image, palette.Size(), frontier.Size());
+	}
+}
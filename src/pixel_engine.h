@@ -0,0 +1,54 @@
+#pragma once
+
+#include "common.h"
+#include "options.h"
+#include "output.h"
+#include "palette.h"
+
+#include <array>
+#include <deque>
+#include <random>
+#include <set>
+#include <vector>
+
+// Frontier of the pixel driven engine.
+// Only the pixel selected by the pick rule is ever popped,
+// so no search over the frontier is needed.
+class PixelFrontier
+{
+public:
+	PixelFrontier(const cv::Mat& image, PickRule rule, std::mt19937& g);
+	bool Empty() const { return size_ == 0; }
+	std::size_t Size() const { return size_; }
+	void Push(const Pos& pos);
+	Pos Pop();
+	// Adds the free neighbours of the just filled pos
+	// and updates the filled neighbour counts of the existing ones.
+	void Filled(const Pos& pos);
+private:
+	void PushToBucket(const Pos& pos);
+	Pos PopFromBuckets();
+	const cv::Mat& image_;
+	PickRule rule_;
+	std::mt19937& g_;
+	cv::Mat inFrontier_;
+	cv::Mat filledNeighbours_;
+	std::size_t size_;
+	std::deque<Pos> queue_;
+	std::vector<Pos> pool_;
+	// Bucket queues by filled neighbour count, may contain stale entries.
+	std::array<std::deque<Pos>, 9> buckets_;
+};
+
+// Number of already filled pixels in the 8-neighbourhood and their mean.
+int NeighbourhoodMean(const cv::Mat& image, Pos pos, ColorDouble& mean);
+
+// Pops frontier pixels and fills each one with the remaining color
+// that is nearest to the mean of its filled neighbours.
+// The mean minimises the summed squared differences to the neighbours and
+// is a close proxy for the ColorPosDiff minimum. Per step the cost is
+// independent of the frontier size.
+// Pixels without filled neighbours get the next color in hue order.
+void GrowPixelDriven(cv::Mat& image, const std::set<Pos>& initPositions,
+					 ColorRuns& colors, PickRule pick,
+					 std::mt19937& g, SnapshotWriter& snapshots);
@@ -0,0 +1,145 @@
+#include "preview_stream.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+
+PreviewStream::PreviewStream(Size canvasSize, int scale, const string& path) :
+	path_(path),
+	canvas_(canvasSize, scale),
+	placements_(0),
+	hasPending_(false),
+	stop_(false)
+{
+	// A vanished reader must not kill the process.
+	signal(SIGPIPE, SIG_IGN);
+	if (mkfifo(path_.c_str(), 0644) && errno != EEXIST)
+		cout << "Could not create " << path_ << endl;
+	cout << "Preview frames: " << canvas_.Frame().cols << "x" << canvas_.Frame().rows
+		<< " bgr24 -> " << path_ << endl;
+	writer_ = thread([this]() { Run(); });
+}
+
+PreviewStream::~PreviewStream()
+{
+	Publish();
+	{
+		lock_guard<mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_one();
+	writer_.join();
+}
+
+void PreviewStream::Placed(const Pos& pos, const Color& color)
+{
+	canvas_.Placed(pos, color);
+	if (++placements_ % framePeriod == 0)
+		Publish();
+}
+
+void PreviewStream::Replaced(const Pos& pos, const Color& oldColor, const Color& color)
+{
+	canvas_.Replaced(pos, oldColor, color);
+	if (++placements_ % framePeriod == 0)
+		Publish();
+}
+
+void PreviewStream::Publish()
+{
+	{
+		lock_guard<mutex> lock(mutex_);
+		// An unsent older frame is simply replaced.
+		canvas_.Frame().copyTo(pending_);
+		hasPending_ = true;
+	}
+	wake_.notify_one();
+}
+
+bool PreviewStream::Stopping()
+{
+	lock_guard<mutex> lock(mutex_);
+	return stop_;
+}
+
+PreviewStream::WriteResult PreviewStream::WriteFrame(int fd, const Mat& frame)
+{
+	bool started = false;
+	// When stopping, a reader that keeps reading gets a moment to take the rest.
+	chrono::steady_clock::time_point giveUp = chrono::steady_clock::time_point::max();
+	for (int y = 0; y < frame.rows; ++y)
+	{
+		const char* data = reinterpret_cast<const char*>(frame.ptr<Channel>(y));
+		size_t left = frame.cols * 3;
+		while (left)
+		{
+			ssize_t written = write(fd, data, left);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written < 0 && errno == EAGAIN)
+			{
+				if (!started)
+					return WriteResult::Dropped;
+				// Finish the frame, the reader expects whole ones.
+				if (Stopping() && giveUp == chrono::steady_clock::time_point::max())
+					giveUp = chrono::steady_clock::now() + chrono::seconds(1);
+				if (chrono::steady_clock::now() > giveUp)
+					return WriteResult::Failed;
+				pollfd writable = {fd, POLLOUT, 0};
+				poll(&writable, 1, 100);
+				continue;
+			}
+			if (written <= 0)
+				return WriteResult::Failed;
+			started = true;
+			data += written;
+			left -= written;
+		}
+	}
+	return WriteResult::Written;
+}
+
+void PreviewStream::Run()
+{
+	int fd = -1;
+	Mat frame;
+	unique_lock<mutex> lock(mutex_);
+	while (true)
+	{
+		wake_.wait(lock, [this]() { return hasPending_ || stop_; });
+		if (fd < 0 && !stop_)
+		{
+			// Non-blocking open fails until a reader is connected.
+			fd = open(path_.c_str(), O_WRONLY | O_NONBLOCK);
+			if (fd < 0)
+			{
+				wake_.wait_for(lock, chrono::milliseconds(100), [this]() { return stop_; });
+				continue;
+			}
+		}
+		// Stopping, after the last frame if a reader is connected.
+		if (!hasPending_ || fd < 0)
+			break;
+		swap(frame, pending_);
+		hasPending_ = false;
+		lock.unlock();
+		WriteResult result = WriteFrame(fd, frame);
+		lock.lock();
+		if (result == WriteResult::Failed)
+		{
+			close(fd);
+			fd = -1;
+		}
+	}
+	if (fd >= 0)
+		close(fd);
+}
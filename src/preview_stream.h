@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.h"
+#include "downscaled_canvas.h"
+#include "output.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Downscaled live view of the canvas, streamed as raw BGR frames into a FIFO
+// (created if missing), e.g. for
+//   ffplay -f rawvideo -pixel_format bgr24 -video_size WxH -i path
+// Every framePeriod placements the frame is handed to a writer thread.
+// The FIFO is written without blocking: frames are dropped while the
+// reader is busy, and a partly written frame is given up a second after
+// stopping, so the growth never waits for the reader and the exit at most
+// that second.
+class PreviewStream : public PlacementListener
+{
+public:
+	PreviewStream(cv::Size canvasSize, int scale, const std::string& path);
+	~PreviewStream();
+	void Placed(const Pos& pos, const Color& color) override;
+	void Replaced(const Pos& pos, const Color& oldColor, const Color& color) override;
+private:
+	static const std::size_t framePeriod = 64;
+	void Publish();
+	void Run();
+	enum class WriteResult
+	{
+		Written,
+		Dropped, // The FIFO was full, nothing was written.
+		Failed // The reader is gone or the stream stopped mid-frame.
+	};
+	WriteResult WriteFrame(int fd, const cv::Mat& frame);
+	bool Stopping();
+	std::string path_;
+	DownscaledCanvas canvas_;
+	std::size_t placements_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	cv::Mat pending_;
+	bool hasPending_;
+	bool stop_;
+	std::thread writer_;
+};
@@ -0,0 +1,103 @@
+#include "preview_window.h"
+
+#include <chrono>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+#ifndef ALLCOLORS_NO_OPENCV
+const char* windowName = "AllColors";
+#endif
+const int freshFlag = 4;
+
+}
+
+PreviewWindow::PreviewWindow(const Mat& image, int scale, SnapshotWriter& snapshots) :
+	image_(image),
+	snapshots_(snapshots),
+	canvas_(image.size(), scale),
+	placements_(0),
+	writeBuffer_(0),
+	sharedBuffer_(1),
+	stop_(false)
+{
+	for (Mat& buffer : buffers_)
+		canvas_.Frame().copyTo(buffer);
+	ui_ = thread([this]() { Run(); });
+}
+
+PreviewWindow::~PreviewWindow()
+{
+	Publish();
+	stop_ = true;
+	ui_.join();
+}
+
+void PreviewWindow::Placed(const Pos& pos, const Color& color)
+{
+	canvas_.Placed(pos, color);
+	if (++placements_ % framePeriod)
+		return;
+	Publish();
+	PollCommands();
+}
+
+void PreviewWindow::Replaced(const Pos& pos, const Color& oldColor, const Color& color)
+{
+	canvas_.Replaced(pos, oldColor, color);
+	if (++placements_ % framePeriod)
+		return;
+	Publish();
+	PollCommands();
+}
+
+void PreviewWindow::Publish()
+{
+	canvas_.Frame().copyTo(buffers_[writeBuffer_]);
+	writeBuffer_ = sharedBuffer_.exchange(writeBuffer_ | freshFlag) & ~freshFlag;
+}
+
+void PreviewWindow::PollCommands()
+{
+	bool paused = false;
+	do
+	{
+		Command command;
+		while (commands_.Pop(command))
+		{
+			if (command == Command::Pause)
+				paused = true;
+			else if (command == Command::Resume)
+				paused = false;
+			else
+				snapshots_.Write(image_);
+		}
+		if (paused)
+			this_thread::sleep_for(chrono::milliseconds(refreshMs));
+	} while (paused && !stop_);
+}
+
+void PreviewWindow::Run()
+{
+#ifndef ALLCOLORS_NO_OPENCV
+	namedWindow(windowName);
+	int shownBuffer = 2;
+	while (!stop_)
+	{
+		if (sharedBuffer_.load() & freshFlag)
+			shownBuffer = sharedBuffer_.exchange(shownBuffer) & ~freshFlag;
+		imshow(windowName, buffers_[shownBuffer]);
+		int key = waitKey(refreshMs);
+		if (key == 'p')
+			commands_.Push(Command::Pause);
+		else if (key == 'r')
+			commands_.Push(Command::Resume);
+		else if (key == 's')
+			commands_.Push(Command::Snapshot);
+	}
+	destroyWindow(windowName);
+#endif
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.h"
+#include "downscaled_canvas.h"
+#include "output.h"
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+// Live view of the growth in a window, driven by its own UI thread at a
+// fixed refresh rate. Every framePeriod placements the generator publishes
+// the downscaled canvas into a spare buffer and swaps it with the shared
+// one, the UI thread swaps that with the one it shows, so neither side
+// ever waits for the other. Keys: p pause, r resume, s snapshot.
+// They are sent to the generator through a lock-free queue, which it
+// polls when publishing.
+// Needs OpenCV's HighGUI, so --preview is not available without OpenCV.
+class PreviewWindow : public PlacementListener
+{
+public:
+	PreviewWindow(const cv::Mat& image, int scale, SnapshotWriter& snapshots);
+	~PreviewWindow();
+	void Placed(const Pos& pos, const Color& color) override;
+	void Replaced(const Pos& pos, const Color& oldColor, const Color& color) override;
+private:
+	enum class Command
+	{
+		Pause,
+		Resume,
+		Snapshot
+	};
+	static const std::size_t framePeriod = 64;
+	static const int refreshMs = 40;
+	void Publish();
+	// Executes the queued commands, waits here while paused.
+	void PollCommands();
+	void Run();
+	const cv::Mat& image_;
+	SnapshotWriter& snapshots_;
+	DownscaledCanvas canvas_;
+	std::size_t placements_;
+	// Buffers: 0..2, one written by the generator, one shown by the UI,
+	// one shared. The shared index carries a fresh flag (+4).
+	cv::Mat buffers_[3];
+	int writeBuffer_;
+	std::atomic<int> sharedBuffer_;
+	SpscQueue<Command, 16> commands_;
+	std::atomic<bool> stop_;
+	std::thread ui_;
+};
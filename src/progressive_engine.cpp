@@ -0,0 +1,63 @@
+#include "progressive_engine.h"
+
+#include <cassert>
+#include <iostream>
+#include <limits>
+
+using namespace cv;
+using namespace std;
+
+Pos ProgressiveSearch::FindBestPos(const Mat& image,
+								   const SummarizedFrontier& frontier, Color color)
+{
+	assert(!frontier.Empty());
+	frontier.Bounds(color, lower_, upper_);
+	float bestUpper = *min_element(upper_.begin(), upper_.end());
+
+	const Frontier& positions = frontier.Positions();
+	double best = numeric_limits<double>::infinity();
+	Pos bestPos;
+	for (size_t i = 0; i < positions.Size(); ++i)
+	{
+		if (lower_[i] > bestUpper)
+			continue;
+		++evaluations_;
+		double diff = ColorPosDiff(image, positions[i], color);
+		if (IsBetter(diff, positions[i], best, bestPos))
+		{
+			best = diff;
+			bestPos = positions[i];
+		}
+	}
+	candidates_ += positions.Size();
+	return bestPos;
+}
+
+void ProgressiveSearch::PrintStats() const
+{
+	cout << "exact evaluations: " << evaluations_ << " of " << candidates_
+		<< " candidates (" << 100.0 * evaluations_ / max(candidates_, 1ULL)
+		<< "%)" << endl;
+}
+
+void GrowProgressive(Mat& image, const set<Pos>& initPositions,
+					 vector<Color>& colors, SnapshotWriter& snapshots)
+{
+	SummarizedFrontier nextPositions(image);
+	for (const Pos& pos : initPositions)
+		nextPositions.Insert(pos);
+	ProgressiveSearch search;
+
+	while (!colors.empty() && !nextPositions.Empty())
+	{
+		Color color = colors.back();
+		colors.pop_back();
+		Pos pos = search.FindBestPos(image, nextPositions, color);
+		nextPositions.Erase(pos);
+		SetPixel(image, pos.first, pos.second, color);
+		snapshots.Placed(pos, color);
+		nextPositions.Filled(pos);
+		snapshots.Update(image, colors.size(), nextPositions.Size());
+	}
+	search.PrintStats();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "common.h"
+#include "output.h"
+#include "summarized_frontier.h"
+
+#include <set>
+#include <vector>
+
+// Exact search in two passes. The first one rates all positions with the
+// cheap bounds of the frontier summaries, the second one evaluates
+// ColorPosDiff only for the positions whose lower bound does not exceed
+// the smallest upper bound. The result is the minimum of the exact
+// search, ties are broken by position.
+class ProgressiveSearch
+{
+public:
+	ProgressiveSearch() : candidates_(0), evaluations_(0) {}
+	Pos FindBestPos(const cv::Mat& image, const SummarizedFrontier& frontier,
+					Color color);
+	void PrintStats() const;
+private:
+	std::vector<float> lower_;
+	std::vector<float> upper_;
+	unsigned long long candidates_;
+	unsigned long long evaluations_;
+};
+
+void GrowProgressive(cv::Mat& image, const std::set<Pos>& initPositions,
+					 std::vector<Color>& colors, SnapshotWriter& snapshots);
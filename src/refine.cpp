@@ -0,0 +1,128 @@
+#include "refine.h"
+#include "analyzer.h"
+#include "parallel.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+const PosComponent tileSize = 8;
+
+// Summed difference of color to the filled neighbours of pos, except other,
+// whose difference does not change when pos and other swap their colors.
+double NeighbourCost(const Mat& image, Pos pos, Color color, Pos other)
+{
+	double cost = 0;
+	for (PosComponent ny = pos.second - 1; ny <= pos.second + 1; ++ny)
+	{
+		for (PosComponent nx = pos.first - 1; nx <= pos.first + 1; ++nx)
+		{
+			if (!IsInside(image, nx, ny) || IsFree(image, nx, ny)
+				|| Pos(nx, ny) == pos || Pos(nx, ny) == other)
+				continue;
+			cost += ColorDiff(color, GetPixel(image, nx, ny));
+		}
+	}
+	return cost;
+}
+
+// A pixel whose color changed from oldColor to color.
+struct Change
+{
+	Pos pos;
+	Color oldColor;
+	Color color;
+};
+
+// Tries one random partner in the tile for every filled pixel of it.
+// The swaps are appended to changes, in order.
+void RefineTile(Mat& image, const Rect& tile, minstd_rand& g, vector<Change>& changes)
+{
+	uniform_int_distribution<PosComponent> xs(tile.x, tile.x + tile.width - 1);
+	uniform_int_distribution<PosComponent> ys(tile.y, tile.y + tile.height - 1);
+	for (PosComponent y = tile.y; y < tile.y + tile.height; ++y)
+	{
+		for (PosComponent x = tile.x; x < tile.x + tile.width; ++x)
+		{
+			Pos a(x, y);
+			Pos b(xs(g), ys(g));
+			if (a == b || IsFree(image, a.first, a.second) || IsFree(image, b.first, b.second))
+				continue;
+			Color colorA = GetPixel(image, a);
+			Color colorB = GetPixel(image, b);
+			double before = NeighbourCost(image, a, colorA, b) + NeighbourCost(image, b, colorB, a);
+			double after = NeighbourCost(image, a, colorB, b) + NeighbourCost(image, b, colorA, a);
+			if (after >= before)
+				continue;
+			SetPixel(image, a.first, a.second, colorB);
+			SetPixel(image, b.first, b.second, colorA);
+			changes.push_back(Change{a, colorA, colorB});
+			changes.push_back(Change{b, colorB, colorA});
+		}
+	}
+}
+
+}
+
+size_t Refine(Mat& image, int maxPasses, double maxSeconds, SnapshotWriter& snapshots)
+{
+	auto start = chrono::steady_clock::now();
+	double meanBefore = Analyze(image).meanDiff;
+	size_t swaps = 0;
+	int pass = 0;
+	for (; maxPasses == 0 || pass < maxPasses; ++pass)
+	{
+		if (maxSeconds > 0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() >= maxSeconds)
+			break;
+		// Tiles of the 4 checkerboard colors, shifted by a pass dependent offset.
+		PosComponent offsetX = pass * 5 % tileSize;
+		PosComponent offsetY = pass * 3 % tileSize;
+		vector<Rect> tiles[4];
+		Rect canvas(0, 0, image.cols, image.rows);
+		for (PosComponent ty = 0; ty * tileSize - offsetY < image.rows; ++ty)
+			for (PosComponent tx = 0; tx * tileSize - offsetX < image.cols; ++tx)
+				tiles[(ty % 2) * 2 + tx % 2].push_back(
+					Rect(tx * tileSize - offsetX, ty * tileSize - offsetY, tileSize, tileSize) & canvas);
+
+		size_t passSwaps = 0;
+		for (int color = 0; color < 4; ++color)
+		{
+			const vector<Rect>& colorTiles = tiles[color];
+			// Per tile generators and results, so the outcome does
+			// not depend on the number of threads.
+			vector<vector<Change>> changes(colorTiles.size());
+			ParallelFor(colorTiles.size(), [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					minstd_rand g(static_cast<unsigned>((pass * 4 + color) * colorTiles.size() + i + 1));
+					RefineTile(image, colorTiles[i], g, changes[i]);
+				}
+			});
+			for (const vector<Change>& tileChanges : changes)
+			{
+				passSwaps += tileChanges.size() / 2;
+				for (const Change& change : tileChanges)
+					snapshots.Replaced(change.pos, change.oldColor, change.color);
+			}
+		}
+		swaps += passSwaps;
+		if (!passSwaps)
+		{
+			++pass;
+			break;
+		}
+	}
+	snapshots.Write(image);
+	cout << "Refinement: " << pass << " passes, " << swaps << " swaps, "
+		<< "neighbour difference mean " << meanBefore << " -> " << Analyze(image).meanDiff
+		<< ", " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+	return swaps;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "common.h"
+#include "output.h"
+
+#include <cstddef>
+
+// Improves a finished canvas without regrowing it: colors of pixel pairs
+// are swapped where that lowers the summed color difference to the filled
+// neighbours. The canvas is split into tiles, colored like a 2x2
+// checkerboard, and the tiles of one color are refined in parallel, since
+// their pixels and neighbourhoods do not overlap. The tiles are shifted
+// every pass, so colors can also move across the tile borders.
+// Stops after maxPasses (0 = no limit) or maxSeconds (0 = no limit),
+// or when a pass finds no swap. Returns the number of swaps.
+std::size_t Refine(cv::Mat& image, int maxPasses, double maxSeconds,
+				   SnapshotWriter& snapshots);
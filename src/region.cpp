@@ -0,0 +1,98 @@
+#include "region.h"
+
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+bool RegrowRegion(Mat& image, const Rect& region,
+				  const ColorEngineSettings& settings, mt19937& g,
+				  SnapshotWriter& snapshots)
+{
+	if (region.area() <= 0 || (region & Rect(0, 0, image.cols, image.rows)) != region)
+	{
+		cout << "The region is not inside the image." << endl;
+		return false;
+	}
+
+	// The region with the surrounding pixels, which stay as they are
+	// but take part in the scores along the border.
+	Rect outer = Rect(region.x - 1, region.y - 1, region.width + 2, region.height + 2)
+		& Rect(0, 0, image.cols, image.rows);
+	Mat window = image(outer);
+	Rect inner(region.x - outer.x, region.y - outer.y, region.width, region.height);
+	auto inRegion = [&](const Pos& pos) -> bool
+	{
+		return inner.contains(Point(pos.first, pos.second));
+	};
+
+	vector<Color> colors;
+	colors.reserve(static_cast<size_t>(region.area()));
+	for (PosComponent y = inner.y; y < inner.br().y; ++y)
+	{
+		for (PosComponent x = inner.x; x < inner.br().x; ++x)
+		{
+			if (!IsFree(window, x, y))
+				colors.push_back(GetPixel(window, x, y));
+			SetPixel(window, x, y, Color(invalidColor, invalidColor, invalidColor));
+		}
+	}
+	shuffle(colors.begin(), colors.end(), g);
+	SortByHue(colors);
+
+	// Seed with the region pixels next to filled ones,
+	// or the center if there are none.
+	Frontier nextPositions(window.size());
+	Color neighbours[9];
+	for (PosComponent y = inner.y; y < inner.br().y; ++y)
+	{
+		for (PosComponent x = inner.x; x < inner.br().x; ++x)
+		{
+			bool border = x == inner.x || y == inner.y ||
+				x == inner.br().x - 1 || y == inner.br().y - 1;
+			if (border && FilledNeighbours(window, Pos(x, y), neighbours) > 0)
+				nextPositions.Insert(Pos(x, y));
+		}
+	}
+	if (nextPositions.Empty())
+		nextPositions.Insert(Pos(inner.x + inner.width / 2, inner.y + inner.height / 2));
+
+	CandidateSampler sampler(settings.quality, settings.search);
+	while (!colors.empty() && !nextPositions.Empty())
+	{
+		Color color = colors.back();
+		colors.pop_back();
+		Pos pos = sampler.FindBestPos(window, nextPositions, color, g, 2);
+		nextPositions.Erase(pos);
+		SetPixel(window, pos.first, pos.second, color);
+		snapshots.Placed(Pos(pos.first + outer.x, pos.second + outer.y), color);
+		sampler.Placed(pos);
+		for (const Pos& freePos : GetFreeNeighbours(window, pos))
+			if (inRegion(freePos))
+				nextPositions.Insert(freePos);
+		// Only the window, so the snapshots cost as little as the search.
+		snapshots.Update(window, colors.size(), nextPositions.Size());
+	}
+	return true;
+}
+
+bool RenderRegion(const Options& options)
+{
+	Mat image = imread(options.source, IMREAD_COLOR);
+	if (!image.rows)
+	{
+		cout << "Could not load " << options.source << endl;
+		return false;
+	}
+	Rect region(options.regionX, options.regionY, options.regionWidth, options.regionHeight);
+	mt19937 g(1);
+	ColorEngineSettings settings;
+	settings.quality = options.quality;
+	settings.search = options.search;
+	SnapshotWriter snapshots(static_cast<size_t>(region.area()), "./output/region");
+	if (!RegrowRegion(image, region, settings, g, snapshots))
+		return false;
+	// Not embellished, so the result can be regrown again.
+	imwrite("./output/regrown.png", image);
+	return true;
+}
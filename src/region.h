@@ -0,0 +1,24 @@
+#pragma once
+
+#include "color_engine.h"
+#include "common.h"
+#include "options.h"
+#include "output.h"
+
+#include <random>
+
+// Regrows a rectangle of a finished image. Its colors are returned to a hue
+// sorted palette and placed again by the color engine, starting at the
+// pixels along the region's border. Only the region and a one pixel margin
+// around it are touched, so the cost depends on the region, not the canvas.
+// The snapshots show only the region with this margin, the placements are
+// reported in image coordinates.
+// Returns false if the region is not inside the image.
+bool RegrowRegion(cv::Mat& image, const cv::Rect& region,
+				  const ColorEngineSettings& settings, std::mt19937& g,
+				  SnapshotWriter& snapshots);
+
+// Regrows options.region of the finished image options.source
+// and writes the result to ./output/regrown.png,
+// the snapshots to ./output/regionNNNN.png.
+bool RenderRegion(const Options& options);
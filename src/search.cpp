@@ -0,0 +1,159 @@
+#include "search.h"
+#include "parallel.h"
+
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+constexpr double SearchDispatcher::hysteresis;
+
+namespace
+{
+
+typedef pair<double, Pos> RatedPos;
+
+RatedPos BestInRange(const Mat& image, const Frontier& nextPositions, Color color,
+					 double divisorExponent, size_t begin, size_t end)
+{
+	RatedPos best(numeric_limits<double>::infinity(), Pos());
+	for (size_t i = begin; i < end; ++i)
+	{
+		const Pos& pos = nextPositions[i];
+		double diff = ColorPosDiff(image, pos, color, divisorExponent);
+		if (IsBetter(diff, pos, best.first, best.second))
+			best = RatedPos(diff, pos);
+	}
+	return best;
+}
+
+typedef function<Pos(const Mat&, const Frontier&, Color, double)> Search;
+
+// Fastest of a few repetitions, in seconds.
+double TimeSearch(const Search& search, const Mat& image, const Frontier& frontier)
+{
+	const int repetitions = 5;
+	double best = numeric_limits<double>::infinity();
+	for (int rep = 0; rep < repetitions; ++rep)
+	{
+		auto start = chrono::steady_clock::now();
+		search(image, frontier, Color(128, 128, 128), 2);
+		best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+}
+
+Pos FindBestPosLinear(const Mat& image, const Frontier& nextPositions, Color color,
+					  double divisorExponent)
+{
+	return BestInRange(image, nextPositions, color, divisorExponent,
+					   0, nextPositions.Size()).second;
+}
+
+Pos FindBestPosParallel(const Mat& image, const Frontier& nextPositions, Color color,
+						double divisorExponent)
+{
+	// Every worker scans the partitions allocated on its node.
+	vector<RatedPos> results(nextPositions.NumPartitions(),
+							 RatedPos(numeric_limits<double>::infinity(), Pos()));
+	ParallelFor(nextPositions.NumPartitions(), [&](size_t begin, size_t end)
+	{
+		for (size_t part = begin; part < end; ++part)
+		{
+			RatedPos& best = results[part];
+			for (const Pos& pos : nextPositions.GetPartition(part))
+			{
+				double diff = ColorPosDiff(image, pos, color, divisorExponent);
+				if (IsBetter(diff, pos, best.first, best.second))
+					best = RatedPos(diff, pos);
+			}
+		}
+	});
+	RatedPos best = results[0];
+	for (const RatedPos& result : results)
+		if (IsBetter(result.first, result.second, best.first, best.second))
+			best = result;
+	return best.second;
+}
+
+SearchDispatcher::SearchDispatcher(SearchMode mode, const string& logPath) :
+	mode_(mode),
+	parallel_(mode == SearchMode::Parallel),
+	switchSize_(numeric_limits<size_t>::max()),
+	searches_(0)
+{
+	if (mode_ != SearchMode::Auto)
+		return;
+	log_.open(logPath);
+	// With a single thread both are the same scan.
+	if (NumThreads() > 1)
+		Calibrate();
+}
+
+void SearchDispatcher::Calibrate()
+{
+	// Half filled random canvas, with a small and a large frontier of free pixels.
+	const size_t smallSize = 256;
+	const size_t largeSize = 65536;
+	mt19937 g(1);
+	Mat image(Size(512, 512), ImageType, Scalar(invalidColor));
+	uniform_int_distribution<int> channel(1, 255);
+	Frontier small(image.size()), large(image.size());
+	for (PosComponent y = 0; y < image.rows; ++y)
+	{
+		for (PosComponent x = 0; x < image.cols; ++x)
+		{
+			if (g() % 2)
+				SetPixel(image, x, y, Color(static_cast<Channel>(channel(g)),
+					static_cast<Channel>(channel(g)), static_cast<Channel>(channel(g))));
+			else if (large.Size() < largeSize)
+			{
+				large.Insert(Pos(x, y));
+				if (small.Size() < smallSize)
+					small.Insert(Pos(x, y));
+			}
+		}
+	}
+
+	Cost costs[2];
+	Search searches[2] = {FindBestPosLinear, FindBestPosParallel};
+	const char* names[2] = {"linear", "parallel"};
+	for (int i = 0; i < 2; ++i)
+	{
+		double smallTime = TimeSearch(searches[i], image, small);
+		double largeTime = TimeSearch(searches[i], image, large);
+		costs[i].perPosition = max(largeTime - smallTime, 0.0) / (large.Size() - small.Size());
+		costs[i].fixed = max(smallTime - costs[i].perPosition * small.Size(), 0.0);
+		log_ << names[i] << " " << costs[i].fixed << " " << costs[i].perPosition << endl;
+	}
+	// Parallel pays off above the size where both lines cross, if at all.
+	double perPositionGain = costs[0].perPosition - costs[1].perPosition;
+	if (perPositionGain > 0)
+		switchSize_ = static_cast<size_t>(max(costs[1].fixed - costs[0].fixed, 0.0) / perPositionGain);
+}
+
+Pos SearchDispatcher::FindBestPos(const Mat& image, const Frontier& nextPositions,
+								  Color color, double divisorExponent)
+{
+	++searches_;
+	if (mode_ == SearchMode::Auto)
+	{
+		double size = static_cast<double>(nextPositions.Size());
+		bool parallel = parallel_ ? size >= switchSize_ * (1 - hysteresis)
+								  : size > switchSize_ * (1 + hysteresis);
+		if (parallel != parallel_ || searches_ == 1)
+		{
+			parallel_ = parallel;
+			log_ << searches_ << " " << nextPositions.Size() << " "
+				<< (parallel_ ? "parallel" : "linear") << endl;
+		}
+	}
+	return parallel_ ? FindBestPosParallel(image, nextPositions, color, divisorExponent)
+					 : FindBestPosLinear(image, nextPositions, color, divisorExponent);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.h"
+#include "frontier.h"
+#include "options.h"
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+
+// Exact searches over the whole frontier. Ties are broken by position
+// (IsBetter), so both find the same position.
+Pos FindBestPosLinear(const cv::Mat& image, const Frontier& nextPositions,
+					  Color color, double divisorExponent);
+Pos FindBestPosParallel(const cv::Mat& image, const Frontier& nextPositions,
+						Color color, double divisorExponent);
+
+// Chooses the linear or parallel search by the frontier size. With
+// SearchMode::Auto the cost of both, a fixed part per search plus a part per
+// position, is measured at construction on a synthetic canvas. The parallel
+// search is used above the size where it gets cheaper, with a hysteresis
+// band around it, so the choice does not flip on every placement.
+// The calibration ("strategy fixedSeconds secondsPerPosition") and every
+// switch ("searches frontierSize strategy") are logged.
+class SearchDispatcher
+{
+public:
+	explicit SearchDispatcher(SearchMode mode,
+		const std::string& logPath = "./output/search.log");
+	Pos FindBestPos(const cv::Mat& image, const Frontier& nextPositions,
+					Color color, double divisorExponent);
+private:
+	struct Cost
+	{
+		double fixed; // Seconds per search.
+		double perPosition; // Seconds per frontier position.
+	};
+	static constexpr double hysteresis = 0.25;
+	void Calibrate();
+	SearchMode mode_;
+	bool parallel_;
+	std::size_t switchSize_; // Frontier size where both cost the same.
+	std::size_t searches_;
+	std::ofstream log_;
+};
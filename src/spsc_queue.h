@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+template<class T, std::size_t capacity>
+class SpscQueue
+{
+public:
+	SpscQueue() : head_(0), tail_(0) {}
+	// False if the queue is full.
+	bool Push(const T& item)
+	{
+		std::size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - head_.load(std::memory_order_acquire) == capacity)
+			return false;
+		items_[tail % capacity] = item;
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+	// False if the queue is empty.
+	bool Pop(T& item)
+	{
+		std::size_t head = head_.load(std::memory_order_relaxed);
+		if (head == tail_.load(std::memory_order_acquire))
+			return false;
+		item = items_[head % capacity];
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+private:
+	std::array<T, capacity> items_;
+	std::atomic<std::size_t> head_;
+	std::atomic<std::size_t> tail_;
+};
@@ -0,0 +1,137 @@
+#include "summarized_frontier.h"
+
+#include <cmath>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+// Compensates the rounding of the single precision bounds.
+const float lowerSlack = 1 - 1e-4f;
+const float upperSlack = 1 + 1e-4f;
+
+const int quantBits = 4;
+const int quantWidth = 256 >> quantBits;
+
+}
+
+SummarizedFrontier::SummarizedFrontier(const Mat& image) :
+	image_(image),
+	frontier_(image.size())
+{
+}
+
+void SummarizedFrontier::Insert(const Pos& pos)
+{
+	if (frontier_.Contains(pos))
+		return;
+	frontier_.Insert(pos);
+	means_.push_back(0);
+	counts_.push_back(0);
+	spreads_.push_back(0);
+	Summarize(frontier_.Size() - 1);
+}
+
+void SummarizedFrontier::Erase(const Pos& pos)
+{
+	size_t idx = frontier_.IndexOf(pos);
+	frontier_.Erase(pos);
+	// Mirror the move of the last position into the gap.
+	means_[idx] = means_.back();
+	counts_[idx] = counts_.back();
+	spreads_[idx] = spreads_.back();
+	means_.pop_back();
+	counts_.pop_back();
+	spreads_.pop_back();
+}
+
+void SummarizedFrontier::Filled(const Pos& pos)
+{
+	PosComponent x, y;
+	tie(x, y) = pos;
+	for (PosComponent nx = x-spread; nx <= x+spread; ++nx)
+	{
+		for (PosComponent ny = y-spread; ny <= y+spread; ++ny)
+		{
+			if (!IsInside(image_, nx, ny) || !IsFree(image_, nx, ny))
+				continue;
+			Pos neighbour(nx, ny);
+			if (frontier_.Contains(neighbour))
+				Summarize(frontier_.IndexOf(neighbour));
+			else
+				Insert(neighbour);
+		}
+	}
+}
+
+void SummarizedFrontier::Summarize(size_t idx)
+{
+	Color neighbours[9];
+	int n = FilledNeighbours(image_, frontier_[idx], neighbours);
+	ColorDouble mean(0, 0, 0);
+	for (int i = 0; i < n; ++i)
+		for (int c = 0; c < 3; ++c)
+			mean[c] += neighbours[i][c];
+	counts_[idx] = static_cast<uint8_t>(n);
+	if (!n)
+	{
+		means_[idx] = 0;
+		spreads_[idx] = 0;
+		return;
+	}
+	uint16_t packed = 0;
+	for (int c = 0; c < 3; ++c)
+	{
+		mean[c] /= n;
+		int quantized = std::min(static_cast<int>(mean[c]) >> quantBits, quantWidth - 1);
+		packed |= static_cast<uint16_t>(quantized << (quantBits * c));
+	}
+	double spreadSum = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		double db = neighbours[i][0] - mean[0];
+		double dg = neighbours[i][1] - mean[1];
+		double dr = neighbours[i][2] - mean[2];
+		spreadSum += sqrt(db*db + dg*dg + dr*dr);
+	}
+	means_[idx] = packed;
+	spreads_[idx] = static_cast<uint16_t>(ceil(spreadSum * upperSlack));
+}
+
+void SummarizedFrontier::Bounds(Color color, vector<float>& lower,
+								vector<float>& upper) const
+{
+	size_t size = frontier_.Size();
+	lower.resize(size);
+	upper.resize(size);
+	const float b = color[0], g = color[1], r = color[2];
+	const float w = quantWidth;
+	const uint16_t mask = (1 << quantBits) - 1;
+	for (size_t i = 0; i < size; ++i)
+	{
+		uint16_t packed = means_[i];
+		float lo[3] = {
+			static_cast<float>(packed & mask) * w,
+			static_cast<float>((packed >> quantBits) & mask) * w,
+			static_cast<float>((packed >> (2 * quantBits)) & mask) * w};
+		float col[3] = {b, g, r};
+		float nearSq = 0;
+		float farSq = 0;
+		for (int c = 0; c < 3; ++c)
+		{
+			float below = lo[c] - col[c];
+			float above = col[c] - (lo[c] + w);
+			float near = std::max(std::max(below, above), 0.0f);
+			float far = std::max(-below, lo[c] + w - col[c]);
+			nearSq += near * near;
+			farSq += far * far;
+		}
+		// Positions without filled neighbours have a diff of 0.
+		float n = counts_[i];
+		float invN = n > 0 ? 1 / n : 0;
+		lower[i] = sqrt(nearSq) * invN * lowerSlack;
+		upper[i] = (n * sqrt(farSq) + spreads_[i]) * invN * invN * upperSlack;
+	}
+}
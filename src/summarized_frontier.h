@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common.h"
+#include "frontier.h"
+
+#include <cstdint>
+#include <vector>
+
+// Frontier with a compact summary of the filled neighbourhood of every
+// position, stored in arrays parallel to the positions:
+// the count n of filled neighbours, their mean color quantized to 4 bits
+// per channel (packed into 16 bits) and their spread, i.e. the summed
+// distance from the mean to the neighbours, rounded up.
+//
+// ColorPosDiff is S/n^2 with S the summed distance of the color c to the
+// neighbours. By the triangle inequality S >= n*|c - mean|, and since the
+// mean lies in its quantization cell, |c - mean| >= dist(c, cell).
+// Also S <= n*|c - mean| + spread <= n*farthest(c, cell) + spread.
+// So dist(c, cell)/n <= ColorPosDiff <= (n*farthest(c, cell) + spread)/n^2.
+class SummarizedFrontier
+{
+public:
+	explicit SummarizedFrontier(const cv::Mat& image);
+	bool Empty() const { return frontier_.Empty(); }
+	std::size_t Size() const { return frontier_.Size(); }
+	const Frontier& Positions() const { return frontier_; }
+	void Insert(const Pos& pos);
+	void Erase(const Pos& pos);
+	// Inserts the free neighbours of the just filled pos
+	// and refreshes the summaries of the existing ones.
+	void Filled(const Pos& pos);
+	// Lower and upper bounds of ColorPosDiff for all positions.
+	void Bounds(Color color, std::vector<float>& lower,
+				std::vector<float>& upper) const;
+private:
+	void Summarize(std::size_t idx);
+	const cv::Mat& image_;
+	Frontier frontier_;
+	std::vector<std::uint16_t> means_;
+	std::vector<std::uint8_t> counts_;
+	std::vector<std::uint16_t> spreads_;
+};
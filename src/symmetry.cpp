@@ -0,0 +1,122 @@
+#include "symmetry.h"
+#include "color_engine.h"
+
+#include <cassert>
+
+using namespace cv;
+using namespace std;
+
+bool NeedsSquareCanvas(Symmetry symmetry)
+{
+	return symmetry == Symmetry::Rotational4 || symmetry == Symmetry::Dihedral8;
+}
+
+vector<Pos> Orbit(const Mat& image, Pos pos, Symmetry symmetry)
+{
+	PosComponent x, y;
+	tie(x, y) = pos;
+	PosComponent mx = image.cols - 1 - x;
+	PosComponent my = image.rows - 1 - y;
+	vector<Pos> orbit(1, pos);
+	switch (symmetry)
+	{
+	case Symmetry::None:
+		break;
+	case Symmetry::MirrorX:
+		orbit.push_back(Pos(mx, y));
+		break;
+	case Symmetry::MirrorXY:
+		orbit.push_back(Pos(mx, y));
+		orbit.push_back(Pos(x, my));
+		orbit.push_back(Pos(mx, my));
+		break;
+	case Symmetry::Rotational4:
+		assert(image.cols == image.rows);
+		orbit.push_back(Pos(my, x));
+		orbit.push_back(Pos(mx, my));
+		orbit.push_back(Pos(y, mx));
+		break;
+	case Symmetry::Dihedral8:
+		assert(image.cols == image.rows);
+		orbit.push_back(Pos(my, x));
+		orbit.push_back(Pos(mx, my));
+		orbit.push_back(Pos(y, mx));
+		orbit.push_back(Pos(mx, y));
+		orbit.push_back(Pos(y, x));
+		orbit.push_back(Pos(x, my));
+		orbit.push_back(Pos(my, mx));
+		break;
+	}
+	// Positions on the symmetry axes map onto themselves.
+	vector<Pos> result;
+	for (const Pos& orbitPos : orbit)
+		if (find(result.begin(), result.end(), orbitPos) == result.end())
+			result.push_back(orbitPos);
+	return result;
+}
+
+Pos Canonical(const Mat& image, Pos pos, Symmetry symmetry)
+{
+	vector<Pos> orbit = Orbit(image, pos, symmetry);
+	return *min_element(orbit.begin(), orbit.end());
+}
+
+namespace
+{
+
+// Reorders the hue sorted queue, so that it pops runs of groupSize nearly
+// equal colors (neighbours in Morton order), the runs still in hue order.
+void GroupSimilarColors(vector<Color>& colors, size_t groupSize)
+{
+	vector<Color> sorted = colors;
+	stable_sort(sorted.begin(), sorted.end(), [](Color c1, Color c2) -> bool
+	{
+		return MortonCode(c1) < MortonCode(c2);
+	});
+	vector<pair<double, size_t>> groups;
+	for (size_t i = 0; i < sorted.size(); i += groupSize)
+		groups.push_back(make_pair(bgr2hsv(sorted[i])[0], i));
+	stable_sort(groups.begin(), groups.end(),
+		[](const pair<double, size_t>& g1, const pair<double, size_t>& g2) -> bool
+	{
+		return g1.first < g2.first;
+	});
+	colors.clear();
+	for (const auto& group : groups)
+	{
+		size_t end = min(group.second + groupSize, sorted.size());
+		colors.insert(colors.end(), sorted.begin() + group.second, sorted.begin() + end);
+	}
+}
+
+}
+
+void GrowSymmetric(Mat& image, const set<Pos>& initPositions,
+				   vector<Color>& colors, Symmetry symmetry, mt19937& g,
+				   SnapshotWriter& snapshots)
+{
+	Frontier nextPositions(image.size());
+	for (const Pos& pos : initPositions)
+		nextPositions.Insert(Canonical(image, pos, symmetry));
+	// Orbits on the symmetry axes are smaller, but they are rare.
+	GroupSimilarColors(colors, Orbit(image, Pos(0, 1), symmetry).size());
+
+	while (!colors.empty() && !nextPositions.Empty())
+	{
+		Pos pos = FindBestPos(image, nextPositions, colors.back(), g);
+		nextPositions.Erase(pos);
+		vector<Pos> orbit = Orbit(image, pos, symmetry);
+		if (orbit.size() > colors.size())
+			orbit.resize(colors.size());
+		for (const Pos& orbitPos : orbit)
+		{
+			SetPixel(image, orbitPos.first, orbitPos.second, colors.back());
+			snapshots.Placed(orbitPos, colors.back());
+			colors.pop_back();
+		}
+		for (const Pos& orbitPos : orbit)
+			for (const Pos& freePos : GetFreeNeighbours(image, orbitPos))
+				nextPositions.Insert(Canonical(image, freePos, symmetry));
+		snapshots.Update(image, colors.size(), nextPositions.Size());
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common.h"
+#include "options.h"
+#include "output.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+bool NeedsSquareCanvas(Symmetry symmetry);
+
+// The distinct positions pos is mapped to by the symmetry, pos first.
+std::vector<Pos> Orbit(const cv::Mat& image, Pos pos, Symmetry symmetry);
+
+// Representative of the orbit of pos, i.e. its position
+// in the fundamental domain.
+Pos Canonical(const cv::Mat& image, Pos pos, Symmetry symmetry);
+
+// Color engine that only keeps the frontier of the fundamental domain.
+// The best position found there is copied to all positions of its orbit,
+// which get consecutive colors of the queue, so every color is still
+// used exactly once.
+void GrowSymmetric(cv::Mat& image, const std::set<Pos>& initPositions,
+				   std::vector<Color>& colors, Symmetry symmetry,
+				   std::mt19937& g, SnapshotWriter& snapshots);
@@ -0,0 +1,86 @@
+#include "target_engine.h"
+
+#include <cassert>
+#include <limits>
+
+using namespace cv;
+using namespace std;
+
+TargetFrontier::TargetFrontier(const Mat& target) :
+	target_(target),
+	slots_(target.size(), CV_32SC1, Scalar_<int>(-1)),
+	cells_(Grid::numCells),
+	size_(0)
+{
+}
+
+void TargetFrontier::Insert(const Pos& pos)
+{
+	int& slot = slots_.at<int>(pos.second, pos.first);
+	if (slot >= 0)
+		return;
+	vector<Pos>& cell = cells_[Grid::CellIndex(GetPixel(target_, pos))];
+	slot = static_cast<int>(cell.size());
+	cell.push_back(pos);
+	++size_;
+}
+
+void TargetFrontier::Erase(const Pos& pos)
+{
+	int& slot = slots_.at<int>(pos.second, pos.first);
+	assert(slot >= 0);
+	vector<Pos>& cell = cells_[Grid::CellIndex(GetPixel(target_, pos))];
+	const Pos& moved = cell.back();
+	slots_.at<int>(moved.second, moved.first) = slot;
+	cell[slot] = moved;
+	cell.pop_back();
+	slot = -1;
+	--size_;
+}
+
+Pos TargetFrontier::FindBestPos(const Mat& image, Color color,
+								double targetWeight) const
+{
+	assert(!Empty());
+	double best = numeric_limits<double>::infinity();
+	Pos bestPos;
+	ColorDouble query(color[0], color[1], color[2]);
+	Grid::VisitShells(query, [&](size_t cellIdx)
+	{
+		for (const Pos& pos : cells_[cellIdx])
+		{
+			double diff = ColorPosDiff(image, target_, targetWeight, pos, color);
+			if (diff < best)
+			{
+				best = diff;
+				bestPos = pos;
+			}
+		}
+	}, [&](double bound) -> bool
+	{
+		return targetWeight * bound >= best;
+	});
+	return bestPos;
+}
+
+void GrowTargetGuided(Mat& image, const Mat& target, double targetWeight,
+					  const set<Pos>& initPositions, vector<Color>& colors,
+					  SnapshotWriter& snapshots)
+{
+	TargetFrontier nextPositions(target);
+	for (const Pos& pos : initPositions)
+		nextPositions.Insert(pos);
+
+	while (!colors.empty() && !nextPositions.Empty())
+	{
+		Color color = colors.back();
+		colors.pop_back();
+		Pos pos = nextPositions.FindBestPos(image, color, targetWeight);
+		nextPositions.Erase(pos);
+		SetPixel(image, pos.first, pos.second, color);
+		snapshots.Placed(pos, color);
+		for (const Pos& freePos : GetFreeNeighbours(image, pos))
+			nextPositions.Insert(freePos);
+		snapshots.Update(image, colors.size(), nextPositions.Size());
+	}
+}
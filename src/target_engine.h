@@ -0,0 +1,37 @@
+#pragma once
+
+#include "color_grid.h"
+#include "common.h"
+#include "output.h"
+
+#include <set>
+#include <vector>
+
+// Frontier positions bucketed by the color the target image has at them.
+// The blended score of a position is at least targetWeight times the
+// distance of the color to the position's target color, so the search
+// visits the buckets nearest to the color first and stops as soon as
+// no remaining bucket can beat the best position found so far.
+class TargetFrontier
+{
+public:
+	explicit TargetFrontier(const cv::Mat& target);
+	bool Empty() const { return size_ == 0; }
+	std::size_t Size() const { return size_; }
+	void Insert(const Pos& pos);
+	void Erase(const Pos& pos);
+	// Position with the minimal blended ColorPosDiff, the first one on ties.
+	Pos FindBestPos(const cv::Mat& image, Color color, double targetWeight) const;
+private:
+	typedef ColorGrid<4> Grid;
+	const cv::Mat& target_;
+	cv::Mat slots_; // Index of a position in its cell, -1 if not contained.
+	std::vector<std::vector<Pos>> cells_;
+	std::size_t size_;
+};
+
+// Places the colors like the color engine, but scores positions by the
+// blend of their neighbourhood and the target image.
+void GrowTargetGuided(cv::Mat& image, const cv::Mat& target, double targetWeight,
+					  const std::set<Pos>& initPositions, std::vector<Color>& colors,
+					  SnapshotWriter& snapshots);
@@ -0,0 +1,180 @@
+#include "tiff_writer.h"
+#include "output.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <zlib.h>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+enum TiffType : uint16_t
+{
+	Short = 3,
+	Long = 4,
+	Long8 = 16
+};
+
+// Little endian output, independent of the host.
+void Put(vector<char>& buffer, uint64_t value, int bytes)
+{
+	for (int i = 0; i < bytes; ++i)
+		buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+// One BigTIFF IFD entry, the value is stored inline (up to 8 bytes).
+void PutEntry(vector<char>& ifd, uint16_t tag, TiffType type, uint64_t count,
+			  uint64_t value)
+{
+	Put(ifd, tag, 2);
+	Put(ifd, type, 2);
+	Put(ifd, count, 8);
+	Put(ifd, value, 8);
+}
+
+// RGB with the horizontal differencing predictor, deflated.
+// False if zlib failed, e.g. without memory.
+bool EncodeTile(vector<Channel>& bgr, vector<Bytef>& compressed)
+{
+	const size_t rowBytes = tiffTileSize * 3;
+	for (size_t row = 0; row < bgr.size(); row += rowBytes)
+	{
+		Channel* pixels = &bgr[row];
+		for (size_t i = 0; i < rowBytes; i += 3)
+			swap(pixels[i], pixels[i + 2]);
+		for (size_t i = rowBytes - 1; i >= 3; --i)
+			pixels[i] = static_cast<Channel>(pixels[i] - pixels[i - 3]);
+	}
+	uLongf size = compressBound(bgr.size());
+	compressed.resize(size);
+	if (compress2(compressed.data(), &size, bgr.data(), bgr.size(), Z_BEST_SPEED) != Z_OK)
+		return false;
+	compressed.resize(size);
+	return true;
+}
+
+}
+
+bool WriteTiledTiff(const string& path, int64_t width, int64_t height,
+					const TileReader& readTile)
+{
+	ofstream file(path, ios::binary);
+	if (!file)
+	{
+		cout << "Could not write " << path << endl;
+		return false;
+	}
+	const uint64_t headerSize = 16;
+	file.write(vector<char>(headerSize).data(), headerSize);
+
+	const int64_t tilesX = (width + tiffTileSize - 1) / tiffTileSize;
+	const int64_t tilesY = (height + tiffTileSize - 1) / tiffTileSize;
+	const size_t numTiles = static_cast<size_t>(tilesX * tilesY);
+	vector<uint64_t> offsets(numTiles);
+	vector<uint64_t> byteCounts(numTiles);
+	uint64_t end = headerSize;
+	atomic<bool> failed(false);
+	mutex fileMutex;
+	ParallelFor(numTiles, [&](size_t begin, size_t last)
+	{
+		vector<Channel> tile(tiffTileSize * tiffTileSize * 3);
+		vector<Bytef> compressed;
+		for (size_t idx = begin; idx < last && !failed; ++idx)
+		{
+			fill(tile.begin(), tile.end(), 0);
+			readTile(static_cast<int64_t>(idx) % tilesX, static_cast<int64_t>(idx) / tilesX,
+					 tile.data());
+			if (!EncodeTile(tile, compressed))
+			{
+				failed = true;
+				break;
+			}
+			lock_guard<mutex> lock(fileMutex);
+			offsets[idx] = end;
+			byteCounts[idx] = compressed.size();
+			file.write(reinterpret_cast<const char*>(compressed.data()),
+					   static_cast<streamsize>(compressed.size()));
+			end += compressed.size();
+		}
+	});
+	if (failed)
+	{
+		cout << "Could not compress the tiles of " << path << endl;
+		return false;
+	}
+
+	// Offset arrays, then the IFD, whose position goes into the header.
+	vector<char> tail;
+	uint64_t offsetsPos = end;
+	for (uint64_t offset : offsets)
+		Put(tail, offset, 8);
+	uint64_t byteCountsPos = end + tail.size();
+	for (uint64_t byteCount : byteCounts)
+		Put(tail, byteCount, 8);
+	uint64_t ifdPos = end + tail.size();
+	const uint64_t numEntries = 12;
+	Put(tail, numEntries, 8);
+	PutEntry(tail, 256, Long, 1, static_cast<uint64_t>(width)); // ImageWidth
+	PutEntry(tail, 257, Long, 1, static_cast<uint64_t>(height)); // ImageLength
+	PutEntry(tail, 258, Short, 3, 8 | 8 << 16 | 8ULL << 32); // BitsPerSample
+	PutEntry(tail, 259, Short, 1, 8); // Compression: deflate
+	PutEntry(tail, 262, Short, 1, 2); // PhotometricInterpretation: RGB
+	PutEntry(tail, 277, Short, 1, 3); // SamplesPerPixel
+	PutEntry(tail, 284, Short, 1, 1); // PlanarConfiguration: chunky
+	PutEntry(tail, 317, Short, 1, 2); // Predictor: horizontal differencing
+	PutEntry(tail, 322, Long, 1, tiffTileSize); // TileWidth
+	PutEntry(tail, 323, Long, 1, tiffTileSize); // TileLength
+	// A single value is stored inline instead of its offset.
+	PutEntry(tail, 324, Long8, numTiles, numTiles == 1 ? offsets[0] : offsetsPos);
+	PutEntry(tail, 325, Long8, numTiles, numTiles == 1 ? byteCounts[0] : byteCountsPos);
+	Put(tail, 0, 8); // No next IFD.
+	file.write(tail.data(), static_cast<streamsize>(tail.size()));
+
+	vector<char> header;
+	header.push_back('I');
+	header.push_back('I');
+	Put(header, 43, 2); // BigTIFF
+	Put(header, 8, 2); // Offset size
+	Put(header, 0, 2);
+	Put(header, ifdPos, 8);
+	file.seekp(0);
+	file.write(header.data(), static_cast<streamsize>(header.size()));
+	if (!file)
+		cout << "Could not write " << path << endl;
+	return static_cast<bool>(file);
+}
+
+bool WriteEmbellishedTiff(const string& path, const Mat& image)
+{
+	// The embellishing filters read two pixels around each pixel (dilate,
+	// then median), so every tile is embellished with that margin, clamped
+	// to the image like the filters' own borders, and only its center kept.
+	const int margin = 2;
+	return WriteTiledTiff(path, image.cols, image.rows,
+		[&](int64_t tileX, int64_t tileY, Channel* bgr)
+	{
+		int x0 = static_cast<int>(tileX * tiffTileSize);
+		int y0 = static_cast<int>(tileY * tiffTileSize);
+		int cols = min(tiffTileSize, image.cols - x0);
+		int rows = min(tiffTileSize, image.rows - y0);
+		int left = max(x0 - margin, 0);
+		int top = max(y0 - margin, 0);
+		Rect area(left, top, min(x0 + cols + margin, image.cols) - left,
+				  min(y0 + rows + margin, image.rows) - top);
+		Mat embellished = Embellish(image(area));
+		for (int y = 0; y < rows; ++y)
+		{
+			const Channel* src = embellished.ptr<Channel>(y0 - top + y) + (x0 - left) * 3;
+			copy(src, src + cols * 3, bgr + y * tiffTileSize * 3);
+		}
+	});
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "common.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+const int tiffTileSize = 256;
+
+// Fills tiffTileSize x tiffTileSize BGR pixels (row-major, zeroed) with the
+// tile at (tileX, tileY). Called concurrently from the worker threads.
+typedef std::function<void(std::int64_t tileX, std::int64_t tileY, Channel* bgr)> TileReader;
+
+// Writes a tiled, deflate compressed BigTIFF. The tiles are read and
+// compressed in parallel and appended to the file as they finish,
+// so besides the tile offsets only one tile per thread is held in memory.
+bool WriteTiledTiff(const std::string& path, std::int64_t width,
+					std::int64_t height, const TileReader& readTile);
+
+// Writes the embellished image (see Embellish) as above. The tiles are
+// embellished one at a time, so no second full frame is needed.
+bool WriteEmbellishedTiff(const std::string& path, const cv::Mat& image);
@@ -0,0 +1,247 @@
+#include "tiled_canvas.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+
+const BigPosComponent TiledCanvas::tileSize;
+const BigPosComponent TiledCanvas::prefetchMargin;
+
+namespace
+{
+
+const size_t tileBytes = TiledCanvas::tileSize * TiledCanvas::tileSize * 3;
+
+}
+
+TiledCanvas::TiledCanvas(BigPosComponent width, BigPosComponent height,
+						 const string& path, size_t maxHotTiles, int previewSide) :
+	width_(width),
+	height_(height),
+	tilesX_((width + tileSize - 1) / tileSize),
+	tilesY_((height + tileSize - 1) / tileSize),
+	maxHotTiles_(max<size_t>(maxHotTiles, 1)),
+	fd_(open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)),
+	previewScale_((max(width, height) + previewSide - 1) / previewSide),
+	preview_(static_cast<int>((height + previewScale_ - 1) / previewScale_),
+			 static_cast<int>((width + previewScale_ - 1) / previewScale_),
+			 ImageType, Scalar_<Channel>(invalidColor)),
+	written_(static_cast<size_t>(tilesX_ * tilesY_), 0),
+	lastIndex_(numeric_limits<size_t>::max()),
+	lastData_(nullptr),
+	loads_(0),
+	prefetches_(0)
+{
+	// The file stays sparse, only written tiles take up disk space.
+	if (fd_ >= 0 && ftruncate(fd_, static_cast<off_t>(written_.size() * tileBytes)))
+	{
+		close(fd_);
+		fd_ = -1;
+	}
+	if (fd_ < 0)
+		cout << "Could not create " << path << endl;
+}
+
+TiledCanvas::~TiledCanvas()
+{
+	for (const HotTile& tile : hot_)
+		munmap(tile.data, tileBytes);
+	if (fd_ >= 0)
+		close(fd_);
+}
+
+Channel* TiledCanvas::Map(size_t index) const
+{
+	void* data = mmap(nullptr, tileBytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+					  fd_, static_cast<off_t>(index * tileBytes));
+	if (data == MAP_FAILED)
+		throw runtime_error("Could not map tile " + to_string(index) + ": " + strerror(errno));
+	return static_cast<Channel*>(data);
+}
+
+bool TiledCanvas::ReadTile(size_t index, Channel* data) const
+{
+	size_t done = 0;
+	while (done < tileBytes)
+	{
+		ssize_t n = pread(fd_, data + done, tileBytes - done,
+						  static_cast<off_t>(index * tileBytes + done));
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR)
+				continue;
+			cout << "Could not read tile " << index << endl;
+			fill(data + done, data + tileBytes, invalidColor);
+			return false;
+		}
+		done += static_cast<size_t>(n);
+	}
+	return true;
+}
+
+Channel* TiledCanvas::Tile(size_t index, bool create)
+{
+	if (index == lastIndex_)
+		return lastData_;
+	if (!written_[index] && !create)
+		return nullptr;
+	written_[index] = 1;
+	auto it = hotIndex_.find(index);
+	if (it != hotIndex_.end())
+		hot_.splice(hot_.begin(), hot_, it->second);
+	else
+	{
+		if (hot_.size() == maxHotTiles_)
+		{
+			const HotTile& coldest = hot_.back();
+			munmap(coldest.data, tileBytes);
+			hotIndex_.erase(coldest.index);
+			hot_.pop_back();
+		}
+		hot_.push_front(HotTile{index, Map(index)});
+		hotIndex_[index] = hot_.begin();
+		++loads_;
+	}
+	lastIndex_ = index;
+	lastData_ = hot_.front().data;
+	return lastData_;
+}
+
+Color TiledCanvas::Get(BigPosComponent x, BigPosComponent y)
+{
+	const Channel* data = Tile(TileIndex(x, y), false);
+	if (!data)
+		return Color(invalidColor, invalidColor, invalidColor);
+	const Channel* pixel = data + PixelOffset(x, y);
+	return Color(pixel[0], pixel[1], pixel[2]);
+}
+
+void TiledCanvas::Set(BigPosComponent x, BigPosComponent y, const Color& color)
+{
+	Channel* pixel = Tile(TileIndex(x, y), true) + PixelOffset(x, y);
+	for (int c = 0; c < 3; ++c)
+		pixel[c] = color[c];
+	if (x % previewScale_ == 0 && y % previewScale_ == 0)
+		preview_.at<Color>(static_cast<int>(y / previewScale_),
+						   static_cast<int>(x / previewScale_)) = color;
+}
+
+void TiledCanvas::Prefetch(const BigPos& pos)
+{
+	BigPosComponent x, y;
+	tie(x, y) = pos;
+	BigPosComponent tx = x / tileSize;
+	BigPosComponent ty = y / tileSize;
+	BigPosComponent dx = x % tileSize < prefetchMargin ? -1
+		: x % tileSize >= tileSize - prefetchMargin ? 1 : 0;
+	BigPosComponent dy = y % tileSize < prefetchMargin ? -1
+		: y % tileSize >= tileSize - prefetchMargin ? 1 : 0;
+	if (!dx && !dy)
+		return;
+	const BigPosComponent rows[] = {ty, ty + dy};
+	const BigPosComponent cols[] = {tx, tx + dx};
+	for (BigPosComponent ny : rows)
+	{
+		for (BigPosComponent nx : cols)
+		{
+			if (nx < 0 || nx >= tilesX_ || ny < 0 || ny >= tilesY_)
+				continue;
+			size_t index = static_cast<size_t>(ny * tilesX_ + nx);
+			if (!written_[index] || hotIndex_.count(index))
+				continue;
+			// Mapping makes the tile hot, the kernel reads it asynchronously.
+			madvise(Tile(index, false), tileBytes, MADV_WILLNEED);
+			++prefetches_;
+		}
+	}
+}
+
+void TiledCanvas::ReadTileRow(BigPosComponent tileY,
+	const function<void(BigPosComponent, const Channel*)>& read)
+{
+	vector<Channel> cold(tileBytes);
+	for (BigPosComponent tileX = 0; tileX < tilesX_; ++tileX)
+	{
+		size_t index = static_cast<size_t>(tileY * tilesX_ + tileX);
+		if (!written_[index])
+			continue;
+		auto it = hotIndex_.find(index);
+		if (it != hotIndex_.end())
+		{
+			read(tileX, it->second->data);
+			continue;
+		}
+		ReadTile(index, cold.data());
+		read(tileX, cold.data());
+	}
+}
+
+void TiledCanvas::CopyTile(BigPosComponent tileX, BigPosComponent tileY,
+						   Channel* bgr) const
+{
+	size_t index = static_cast<size_t>(tileY * tilesX_ + tileX);
+	if (!written_[index])
+	{
+		fill(bgr, bgr + tileBytes, invalidColor);
+		return;
+	}
+	auto it = hotIndex_.find(index);
+	if (it != hotIndex_.end())
+	{
+		copy(it->second->data, it->second->data + tileBytes, bgr);
+		return;
+	}
+	ReadTile(index, bgr);
+}
+
+bool TiledCanvas::WritePpm(const string& path)
+{
+	ofstream file(path, ios::binary);
+	file << "P6\n" << width_ << " " << height_ << "\n255\n";
+	vector<Channel> strip(static_cast<size_t>(width_ * tileSize * 3));
+	for (BigPosComponent tileY = 0; tileY < tilesY_ && file; ++tileY)
+	{
+		fill(strip.begin(), strip.end(), invalidColor);
+		BigPosComponent rows = min(tileSize, height_ - tileY * tileSize);
+		ReadTileRow(tileY, [&](BigPosComponent tileX, const Channel* data)
+		{
+			BigPosComponent x0 = tileX * tileSize;
+			BigPosComponent cols = min(tileSize, width_ - x0);
+			for (BigPosComponent y = 0; y < rows; ++y)
+			{
+				const Channel* src = data + PixelOffset(0, y);
+				Channel* dst = &strip[static_cast<size_t>((y * width_ + x0) * 3)];
+				// PPM stores RGB, the canvas BGR.
+				for (BigPosComponent x = 0; x < cols; ++x, src += 3, dst += 3)
+				{
+					dst[0] = src[2];
+					dst[1] = src[1];
+					dst[2] = src[0];
+				}
+			}
+		});
+		file.write(reinterpret_cast<const char*>(strip.data()),
+				   static_cast<streamsize>(rows * width_ * 3));
+	}
+	if (!file)
+		cout << "Could not write " << path << endl;
+	return static_cast<bool>(file);
+}
+
+void TiledCanvas::PrintStats() const
+{
+	size_t written = static_cast<size_t>(count(written_.begin(), written_.end(), 1));
+	cout << "Tiles written: " << written << "/" << written_.size()
+		<< ", loaded: " << loads_ << ", prefetched: " << prefetches_ << endl;
+}
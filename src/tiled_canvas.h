@@ -0,0 +1,109 @@
+#pragma once
+
+#include "common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Coordinates of canvases beyond 2^31 pixels.
+typedef std::int64_t BigPosComponent;
+typedef std::pair<BigPosComponent, BigPosComponent> BigPos;
+
+struct BigPosHash
+{
+	std::size_t operator()(const BigPos& pos) const
+	{
+		return std::hash<BigPosComponent>()(pos.first * 0x9E3779B97F4A7C15ULL ^ pos.second);
+	}
+};
+
+// Canvas for renders that do not fit into memory.
+// The pixels are stored tile by tile in a (sparse) memory mapped file.
+// Only the most recently used tiles stay mapped, the kernel writes back
+// the evicted ones. Tiles that were never written are known to be empty,
+// so they are neither mapped nor read. Failing to map a tile (e.g. when
+// running out of address space or mappings) throws std::runtime_error.
+class TiledCanvas
+{
+public:
+	static const BigPosComponent tileSize = 256;
+	// The preview has at most previewSide pixels per side.
+	TiledCanvas(BigPosComponent width, BigPosComponent height,
+				const std::string& path, std::size_t maxHotTiles, int previewSide);
+	~TiledCanvas();
+	TiledCanvas(const TiledCanvas&) = delete;
+	TiledCanvas& operator=(const TiledCanvas&) = delete;
+	// False if the backing file could not be created.
+	bool Valid() const { return fd_ >= 0; }
+	BigPosComponent Width() const { return width_; }
+	BigPosComponent Height() const { return height_; }
+	bool IsInside(BigPosComponent x, BigPosComponent y) const
+	{
+		return x >= 0 && x < width_ && y >= 0 && y < height_;
+	}
+	Color Get(BigPosComponent x, BigPosComponent y);
+	void Set(BigPosComponent x, BigPosComponent y, const Color& color);
+	bool IsFree(BigPosComponent x, BigPosComponent y)
+	{
+		return Get(x, y)[0] == invalidColor;
+	}
+	// Called for every new frontier position. If it is near the border
+	// of its tile, the written neighbouring tiles are mapped and the kernel
+	// is asked to read them in before the growth reaches them.
+	void Prefetch(const BigPos& pos);
+	// Downscaled copy, every previewScale-th pixel in both directions.
+	// Kept up to date by Set, so no tiles are touched for it.
+	const cv::Mat& Preview() const { return preview_; }
+	// Copies a tile (tileSize x tileSize BGR pixels) into bgr, zeros if it
+	// was never written. Safe to call concurrently while nothing is set.
+	void CopyTile(BigPosComponent tileX, BigPosComponent tileY, Channel* bgr) const;
+	// Streams the full resolution canvas into a binary PPM file,
+	// one row of tiles at a time.
+	bool WritePpm(const std::string& path);
+	void PrintStats() const;
+private:
+	static const BigPosComponent prefetchMargin = 16;
+	struct HotTile
+	{
+		std::size_t index;
+		Channel* data;
+	};
+	std::size_t TileIndex(BigPosComponent x, BigPosComponent y) const
+	{
+		return static_cast<std::size_t>((y / tileSize) * tilesX_ + x / tileSize);
+	}
+	static std::size_t PixelOffset(BigPosComponent x, BigPosComponent y)
+	{
+		return static_cast<std::size_t>(((y % tileSize) * tileSize + x % tileSize) * 3);
+	}
+	// Mapped data of a tile, null if it was never written and !create.
+	Channel* Tile(std::size_t index, bool create);
+	Channel* Map(std::size_t index) const;
+	// Reads a tile that is not mapped from the file, false on errors.
+	bool ReadTile(std::size_t index, Channel* data) const;
+	// Calls read with the data of every written tile of a tile row,
+	// without disturbing the hot tiles. Cold tiles are read, not mapped.
+	void ReadTileRow(BigPosComponent tileY,
+		const std::function<void(BigPosComponent tileX, const Channel* data)>& read);
+	BigPosComponent width_;
+	BigPosComponent height_;
+	BigPosComponent tilesX_;
+	BigPosComponent tilesY_;
+	std::size_t maxHotTiles_;
+	int fd_;
+	BigPosComponent previewScale_;
+	cv::Mat preview_;
+	std::vector<unsigned char> written_;
+	std::list<HotTile> hot_; // Most recently used first.
+	std::unordered_map<std::size_t, std::list<HotTile>::iterator> hotIndex_;
+	std::size_t lastIndex_;
+	Channel* lastData_;
+	std::size_t loads_;
+	std::size_t prefetches_;
+};
@@ -0,0 +1,264 @@
+#include "warmstart_engine.h"
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+// Covers the rounding of the single precision means.
+const double meanSlack = 1e-3;
+
+// Positions without filled neighbours (minCount 0) have a diff of 0.
+double LowerBound(const double* color, const float* lo, const float* hi,
+				  int minCount, int maxCount)
+{
+	if (!minCount)
+		return 0;
+	double distSq = 0;
+	for (int c = 0; c < 3; ++c)
+	{
+		double d = std::max(std::max(lo[c] - color[c], color[c] - hi[c]), 0.0);
+		distSq += d * d;
+	}
+	return std::max(sqrt(distSq) - meanSlack, 0.0) / maxCount;
+}
+
+}
+
+WarmStartFrontier::WarmStartFrontier(const Mat& image) :
+	image_(image),
+	regionsPerRow_((image.cols + regionSize - 1) / regionSize),
+	regions_(regionsPerRow_ * ((image.rows + regionSize - 1) / regionSize)),
+	slots_(image.size(), CV_32SC1, Scalar_<int>(-1)),
+	activeSlots_(regions_.size(), -1),
+	size_(0),
+	searches_(0),
+	warmSearches_(0),
+	warmOptimal_(0),
+	regionsScanned_(0),
+	regionsTotal_(0),
+	evaluations_(0),
+	candidates_(0)
+{
+}
+
+size_t WarmStartFrontier::RegionIndex(const Pos& pos) const
+{
+	return static_cast<size_t>(pos.second / regionSize) * regionsPerRow_
+		+ pos.first / regionSize;
+}
+
+void WarmStartFrontier::Summarize(Entry& entry) const
+{
+	Color neighbours[9];
+	entry.count = FilledNeighbours(image_, entry.pos, neighbours);
+	for (int c = 0; c < 3; ++c)
+	{
+		double sum = 0;
+		for (int i = 0; i < entry.count; ++i)
+			sum += neighbours[i][c];
+		entry.mean[c] = static_cast<float>(entry.count ? sum / entry.count : 0);
+	}
+}
+
+void WarmStartFrontier::Widen(Region& region, const Entry& entry) const
+{
+	for (int c = 0; c < 3; ++c)
+	{
+		region.lo[c] = std::min(region.lo[c], entry.mean[c]);
+		region.hi[c] = std::max(region.hi[c], entry.mean[c]);
+	}
+	region.minCount = std::min(region.minCount, entry.count);
+	region.maxCount = std::max(region.maxCount, entry.count);
+}
+
+void WarmStartFrontier::Tighten(Region& region) const
+{
+	for (int c = 0; c < 3; ++c)
+	{
+		region.lo[c] = numeric_limits<float>::max();
+		region.hi[c] = -numeric_limits<float>::max();
+	}
+	region.minCount = numeric_limits<int>::max();
+	region.maxCount = 0;
+	for (const Entry& entry : region.entries)
+		Widen(region, entry);
+}
+
+void WarmStartFrontier::Insert(const Pos& pos)
+{
+	int& slot = slots_.at<int>(pos.second, pos.first);
+	if (slot >= 0)
+		return;
+	size_t regionIdx = RegionIndex(pos);
+	Region& region = regions_[regionIdx];
+	if (region.entries.empty())
+	{
+		activeSlots_[regionIdx] = static_cast<int>(activeRegions_.size());
+		activeRegions_.push_back(regionIdx);
+		region.entries.push_back(Entry{pos, {0, 0, 0}, 0});
+		Summarize(region.entries.back());
+		Tighten(region);
+	}
+	else
+	{
+		region.entries.push_back(Entry{pos, {0, 0, 0}, 0});
+		Summarize(region.entries.back());
+		Widen(region, region.entries.back());
+	}
+	slot = static_cast<int>(region.entries.size()) - 1;
+	++size_;
+}
+
+void WarmStartFrontier::Erase(const Pos& pos)
+{
+	int& slot = slots_.at<int>(pos.second, pos.first);
+	assert(slot >= 0);
+	size_t regionIdx = RegionIndex(pos);
+	vector<Entry>& entries = regions_[regionIdx].entries;
+	const Pos& moved = entries.back().pos;
+	slots_.at<int>(moved.second, moved.first) = slot;
+	entries[slot] = entries.back();
+	entries.pop_back();
+	slot = -1;
+	--size_;
+	if (!entries.empty())
+		return;
+	size_t movedRegion = activeRegions_.back();
+	activeSlots_[movedRegion] = activeSlots_[regionIdx];
+	activeRegions_[activeSlots_[regionIdx]] = movedRegion;
+	activeRegions_.pop_back();
+	activeSlots_[regionIdx] = -1;
+}
+
+void WarmStartFrontier::Filled(const Pos& pos)
+{
+	recent_.push_front(pos);
+	if (recent_.size() > numRecent)
+		recent_.pop_back();
+
+	PosComponent x, y;
+	tie(x, y) = pos;
+	for (PosComponent nx = x-spread; nx <= x+spread; ++nx)
+	{
+		for (PosComponent ny = y-spread; ny <= y+spread; ++ny)
+		{
+			if (!IsInside(image_, nx, ny) || !IsFree(image_, nx, ny))
+				continue;
+			Pos neighbour(nx, ny);
+			int slot = slots_.at<int>(ny, nx);
+			if (slot < 0)
+			{
+				Insert(neighbour);
+				continue;
+			}
+			Region& region = regions_[RegionIndex(neighbour)];
+			Summarize(region.entries[slot]);
+			Widen(region, region.entries[slot]);
+		}
+	}
+}
+
+Pos WarmStartFrontier::FindBestPos(Color color)
+{
+	assert(!Empty());
+	double best = numeric_limits<double>::infinity();
+	Pos bestPos;
+
+	// Warm start around the last placements.
+	for (const Pos& pos : recent_)
+	{
+		for (PosComponent y = pos.second - recentRadius; y <= pos.second + recentRadius; ++y)
+		{
+			for (PosComponent x = pos.first - recentRadius; x <= pos.first + recentRadius; ++x)
+			{
+				if (!IsInside(image_, x, y) || slots_.at<int>(y, x) < 0)
+					continue;
+				double diff = ColorPosDiff(image_, Pos(x, y), color);
+				++evaluations_;
+				if (IsBetter(diff, Pos(x, y), best, bestPos))
+				{
+					best = diff;
+					bestPos = Pos(x, y);
+				}
+			}
+		}
+	}
+	// Without a free position around the last placements there is no warm start.
+	bool warm = best < numeric_limits<double>::infinity();
+	Pos warmPos = bestPos;
+
+	const double query[3] = {
+		static_cast<double>(color[0]),
+		static_cast<double>(color[1]),
+		static_cast<double>(color[2])};
+	for (size_t regionIdx : activeRegions_)
+	{
+		Region& region = regions_[regionIdx];
+		candidates_ += region.entries.size();
+		// Equal bounds are not skipped, they may still win a tie.
+		if (LowerBound(query, region.lo, region.hi, region.minCount, region.maxCount) > best)
+			continue;
+		++regionsScanned_;
+		for (const Entry& entry : region.entries)
+		{
+			if (LowerBound(query, entry.mean, entry.mean, entry.count, entry.count) > best)
+				continue;
+			double diff = ColorPosDiff(image_, entry.pos, color);
+			++evaluations_;
+			if (IsBetter(diff, entry.pos, best, bestPos))
+			{
+				best = diff;
+				bestPos = entry.pos;
+			}
+		}
+		Tighten(region);
+	}
+
+	++searches_;
+	regionsTotal_ += activeRegions_.size();
+	if (warm)
+	{
+		++warmSearches_;
+		if (bestPos == warmPos)
+			++warmOptimal_;
+	}
+	return bestPos;
+}
+
+void WarmStartFrontier::PrintStats() const
+{
+	cout << "warm start optimal: " << 100.0 * warmOptimal_ / max(warmSearches_, 1ULL)
+		<< "% of " << warmSearches_ << " warm started of " << searches_
+		<< " searches, regions scanned: "
+		<< 100.0 * regionsScanned_ / max(regionsTotal_, 1ULL)
+		<< "%, exact evaluations: "
+		<< 100.0 * evaluations_ / max(candidates_, 1ULL) << "%" << endl;
+}
+
+void GrowWarmStart(Mat& image, const set<Pos>& initPositions,
+				   vector<Color>& colors, SnapshotWriter& snapshots)
+{
+	WarmStartFrontier nextPositions(image);
+	for (const Pos& pos : initPositions)
+		nextPositions.Insert(pos);
+
+	while (!colors.empty() && !nextPositions.Empty())
+	{
+		Color color = colors.back();
+		colors.pop_back();
+		Pos pos = nextPositions.FindBestPos(color);
+		nextPositions.Erase(pos);
+		SetPixel(image, pos.first, pos.second, color);
+		snapshots.Placed(pos, color);
+		nextPositions.Filled(pos);
+		snapshots.Update(image, colors.size(), nextPositions.Size());
+	}
+	nextPositions.PrintStats();
+}
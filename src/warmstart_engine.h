@@ -0,0 +1,74 @@
+#pragma once
+
+#include "common.h"
+#include "output.h"
+
+#include <deque>
+#include <set>
+#include <vector>
+
+// Frontier split into square regions for the warm started exact search.
+// Every position keeps the mean color m and count n of its filled
+// neighbours. ColorPosDiff >= |c - m|/n holds by the triangle inequality,
+// and every region keeps a box around the means of its positions and their
+// smallest and largest n, which bounds the whole region. The box only grows while
+// positions change and is tightened whenever the region is scanned.
+//
+// The search first rates the positions around the last placements,
+// where the hue sorted colors usually end up, and uses the result as
+// the bound to skip whole regions and single positions.
+class WarmStartFrontier
+{
+public:
+	explicit WarmStartFrontier(const cv::Mat& image);
+	bool Empty() const { return size_ == 0; }
+	std::size_t Size() const { return size_; }
+	void Insert(const Pos& pos);
+	void Erase(const Pos& pos);
+	// Inserts the free neighbours of the just filled pos and updates
+	// the means of the existing ones.
+	void Filled(const Pos& pos);
+	// Exact minimum of ColorPosDiff, ties are broken by position.
+	Pos FindBestPos(Color color);
+	void PrintStats() const;
+private:
+	struct Entry
+	{
+		Pos pos;
+		float mean[3];
+		int count;
+	};
+	struct Region
+	{
+		std::vector<Entry> entries;
+		float lo[3];
+		float hi[3];
+		int minCount;
+		int maxCount;
+	};
+	static const PosComponent regionSize = 32;
+	static const std::size_t numRecent = 4;
+	static const PosComponent recentRadius = 2;
+	std::size_t RegionIndex(const Pos& pos) const;
+	void Summarize(Entry& entry) const;
+	void Widen(Region& region, const Entry& entry) const;
+	void Tighten(Region& region) const;
+	const cv::Mat& image_;
+	int regionsPerRow_;
+	std::vector<Region> regions_;
+	cv::Mat slots_; // Index of a position in its region, -1 if not contained.
+	std::vector<std::size_t> activeRegions_;
+	std::vector<int> activeSlots_; // Index in activeRegions_, -1 if empty.
+	std::size_t size_;
+	std::deque<Pos> recent_;
+	unsigned long long searches_;
+	unsigned long long warmSearches_; // Searches with a non-empty warm set.
+	unsigned long long warmOptimal_;
+	unsigned long long regionsScanned_;
+	unsigned long long regionsTotal_;
+	unsigned long long evaluations_;
+	unsigned long long candidates_;
+};
+
+void GrowWarmStart(cv::Mat& image, const std::set<Pos>& initPositions,
+				   std::vector<Color>& colors, SnapshotWriter& snapshots);
@@ -0,0 +1,335 @@
+// Microbenchmarks of the hot functions, for tracing regressions to a
+// single building block. Every benchmark is repeated and reported as one
+// JSON object per line, e.g.
+//   ./release/microbench [namePattern] [--repetitions=N] [--huge-pages=on/off] > bench.jsonl
+// Running it with huge pages on and off shows their effect on the TLB
+// misses, e.g. of FindBestPos/100000 and Frontier/InsertErase.
+// The pattern is matched against the whole name, with shell wildcards,
+// e.g. "FindBestPos/*". Every benchmark draws its inputs from its own
+// generator seeded by its name, so it measures the same inputs whether
+// it runs alone or with the others.
+// The canvases are synthetic growth stages, not snapshots of the color
+// engine: clusters grown from random seeds by random frontier picks with
+// smoothly varying colors, stopped when the frontier reaches the wanted
+// size. Their frontiers are more ragged than those of real runs, whose
+// 100K position frontiers take hours of exact searches to reach, so
+// compare the FindBestPos and Frontier numbers only with each other.
+
+#include "../src/color_engine.h"
+#include "../src/common.h"
+#include "../src/frontier.h"
+#include "../src/huge_pages.h"
+#include "../src/output.h"
+#include "../src/perf_counter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fnmatch.h>
+
+using namespace cv;
+using namespace std;
+
+namespace
+{
+
+// Keeps the results alive, so the compiler cannot drop the work.
+volatile double sink;
+
+struct Stage
+{
+	Mat image;
+	vector<Pos> frontier;
+};
+
+// Grows random clusters (not the color engine) until the frontier has at
+// least frontierSize positions or the canvas is filled up to maxFill.
+Stage SyntheticStage(Size size, size_t frontierSize, double maxFill, mt19937& g)
+{
+	Stage stage;
+	// Like the canvas of a run, in huge pages unless --huge-pages=off.
+	stage.image = Mat(size, ImageType);
+	AdviseHugePages(stage.image.data, stage.image.total() * stage.image.elemSize());
+	stage.image.setTo(Scalar(invalidColor));
+	Frontier frontier(size);
+	uniform_int_distribution<PosComponent> xs(0, size.width - 1), ys(0, size.height - 1);
+	uniform_int_distribution<int> jitter(-6, 6);
+	size_t seeds = max<size_t>(frontierSize / 256, 2);
+	for (size_t i = 0; i < seeds; ++i)
+		frontier.Insert(Pos(xs(g), ys(g)));
+	size_t maxPixels = static_cast<size_t>(maxFill * size.area());
+	for (size_t placed = 0; placed < maxPixels && !frontier.Empty()
+		 && frontier.Size() < frontierSize; ++placed)
+	{
+		Pos pos = frontier[uniform_int_distribution<size_t>(0, frontier.Size() - 1)(g)];
+		frontier.Erase(pos);
+		// The mean of the filled neighbours, slightly changed, or a color
+		// of a hue gradient over the canvas for new clusters.
+		Color neighbours[9];
+		int count = FilledNeighbours(stage.image, pos, neighbours);
+		Color color(static_cast<Channel>(64 + 191 * pos.first / size.width),
+					static_cast<Channel>(64 + 191 * pos.second / size.height), 128);
+		for (int c = 0; c < 3 && count; ++c)
+		{
+			int sum = 0;
+			for (int i = 0; i < count; ++i)
+				sum += neighbours[i][c];
+			color[c] = static_cast<Channel>(min(max(sum / count + jitter(g), 1), 255));
+		}
+		SetPixel(stage.image, pos.first, pos.second, color);
+		for (const Pos& freePos : GetFreeNeighbours(stage.image, pos))
+			frontier.Insert(freePos);
+	}
+	stage.frontier.assign(frontier.begin(), frontier.end());
+	if (stage.frontier.size() > frontierSize)
+		stage.frontier.resize(frontierSize);
+	return stage;
+}
+
+vector<Color> RandomColors(size_t n, mt19937& g)
+{
+	uniform_int_distribution<int> channel(1, 255);
+	vector<Color> colors(n);
+	for (Color& color : colors)
+		color = Color(static_cast<Channel>(channel(g)), static_cast<Channel>(channel(g)),
+					  static_cast<Channel>(channel(g)));
+	return colors;
+}
+
+struct Statistics
+{
+	double median;
+	double variance;
+};
+
+Statistics Summarize(vector<double> values)
+{
+	sort(values.begin(), values.end());
+	double mean = 0;
+	for (double value : values)
+		mean += value / values.size();
+	double variance = 0;
+	for (double value : values)
+		variance += (value - mean) * (value - mean) / values.size();
+	return Statistics{values[values.size() / 2], variance};
+}
+
+string Number(double value, bool valid)
+{
+	if (!valid)
+		return "null";
+	ostringstream ss;
+	ss << value;
+	return ss.str();
+}
+
+class Runner
+{
+public:
+	Runner(const string& pattern, int repetitions) :
+		pattern_(pattern), repetitions_(repetitions) {}
+	// The generator of the benchmark that is running.
+	mt19937& Random() { return g_; }
+	// Seeds Random() from the name, calls setup once, then run once
+	// for warming up and repetitions_ times measured. setup returns
+	// the number of items run processes, known only once the inputs exist.
+	void Run(const string& name, const function<size_t()>& setup,
+			 const function<void()>& run)
+	{
+		if (!pattern_.empty() && fnmatch(pattern_.c_str(), name.c_str(), 0) != 0)
+			return;
+		seed_seq seed(name.begin(), name.end());
+		g_.seed(seed);
+		size_t items = setup();
+		run();
+		vector<double> cycles, nanoseconds, tlbMisses;
+		bool countersValid = true;
+		for (int rep = 0; rep < repetitions_; ++rep)
+		{
+			PerfCounter cycleCounter(PerfEvent::Cycles);
+			PerfCounter tlbCounter(PerfEvent::DtlbLoadMisses);
+			auto start = chrono::steady_clock::now();
+			run();
+			auto end = chrono::steady_clock::now();
+			uint64_t repCycles = cycleCounter.Value();
+			uint64_t repMisses = tlbCounter.Value();
+			countersValid = countersValid && cycleCounter.Valid() && tlbCounter.Valid();
+			cycles.push_back(static_cast<double>(repCycles) / items);
+			tlbMisses.push_back(static_cast<double>(repMisses) / items);
+			nanoseconds.push_back(chrono::duration<double, nano>(end - start).count() / items);
+		}
+		Statistics cycleStats = Summarize(cycles);
+		Statistics nsStats = Summarize(nanoseconds);
+		Statistics tlbStats = Summarize(tlbMisses);
+		cout << "{\"name\": \"" << name << "\", \"items\": " << items
+			<< ", \"repetitions\": " << repetitions_
+			<< ", \"huge_pages\": " << (HugePagesEnabled() ? "true" : "false")
+			<< ", \"cycles_per_item\": " << Number(cycleStats.median, countersValid)
+			<< ", \"cycles_variance\": " << Number(cycleStats.variance, countersValid)
+			<< ", \"ns_per_item\": " << nsStats.median
+			<< ", \"ns_variance\": " << nsStats.variance
+			<< ", \"dtlb_misses_per_item\": " << Number(tlbStats.median, countersValid)
+			<< "}" << endl;
+	}
+private:
+	string pattern_;
+	int repetitions_;
+	mt19937 g_;
+};
+
+}
+
+int main(int argc, char *argv[])
+{
+	string pattern;
+	int repetitions = 15;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg.compare(0, 14, "--repetitions=") == 0)
+		{
+			const char* value = arg.c_str() + 14;
+			char* end = nullptr;
+			errno = 0;
+			long parsed = strtol(value, &end, 10);
+			if (end == value || *end != '\0' || errno == ERANGE
+				|| parsed < 1 || parsed > INT_MAX)
+			{
+				cout << "Invalid option: " << arg << endl;
+				return 1;
+			}
+			repetitions = static_cast<int>(parsed);
+		}
+		else if (arg == "--huge-pages=on")
+			SetHugePagesEnabled(true);
+		else if (arg == "--huge-pages=off")
+			SetHugePagesEnabled(false);
+		else
+			pattern = arg;
+	}
+	Runner runner(pattern, repetitions);
+	mt19937& g = runner.Random();
+
+	const size_t numColors = 1 << 20;
+	vector<Color> colors1, colors2;
+	runner.Run("ColorDiff", [&]() -> size_t
+	{
+		colors1 = RandomColors(numColors, g);
+		colors2 = RandomColors(numColors, g);
+		return colors1.size();
+	}, [&]()
+	{
+		double sum = 0;
+		for (size_t i = 0; i < numColors; ++i)
+			sum += ColorDiff(colors1[i], colors2[i]);
+		sink = sum;
+	});
+
+	runner.Run("bgr2hsv", [&]() -> size_t
+	{
+		colors1 = RandomColors(numColors, g);
+		return colors1.size();
+	}, [&]()
+	{
+		double sum = 0;
+		for (const Color& color : colors1)
+			sum += bgr2hsv(color)[0];
+		sink = sum;
+	});
+
+	Stage stage;
+	const size_t stageFrontier = 10000;
+	runner.Run("ColorPosDiff", [&]() -> size_t
+	{
+		stage = SyntheticStage(Size(1920, 1080), stageFrontier, 0.5, g);
+		colors1 = RandomColors(stage.frontier.size(), g);
+		return stage.frontier.size();
+	}, [&]()
+	{
+		double sum = 0;
+		for (size_t i = 0; i < stage.frontier.size(); ++i)
+			sum += ColorPosDiff(stage.image, stage.frontier[i], colors1[i]);
+		sink = sum;
+	});
+
+	runner.Run("GetFreeNeighbours", [&]() -> size_t
+	{
+		stage = SyntheticStage(Size(1920, 1080), stageFrontier, 0.5, g);
+		return stage.frontier.size();
+	}, [&]()
+	{
+		size_t sum = 0;
+		for (const Pos& pos : stage.frontier)
+			sum += GetFreeNeighbours(stage.image, pos).size();
+		sink = static_cast<double>(sum);
+	});
+
+	// Rates every frontier position for a few colors,
+	// items are the rated positions.
+	const size_t searchColors = 8;
+	for (size_t frontierSize : {1000, 10000, 100000})
+	{
+		unique_ptr<Frontier> frontier;
+		runner.Run("FindBestPos/" + to_string(frontierSize), [&]() -> size_t
+		{
+			stage = SyntheticStage(Size(3840, 2160), frontierSize, 0.5, g);
+			frontier.reset(new Frontier(stage.image.size()));
+			for (const Pos& pos : stage.frontier)
+				frontier->Insert(pos);
+			colors1 = RandomColors(searchColors, g);
+			return stage.frontier.size() * searchColors;
+		}, [&]()
+		{
+			PosComponent sum = 0;
+			for (const Color& color : colors1)
+				sum += FindBestPos(stage.image, *frontier, color, g).first;
+			sink = sum;
+		});
+	}
+
+	// Inserts all positions of a 100K frontier, then erases them
+	// in random order. Items are the operations.
+	vector<Pos> shuffled;
+	unique_ptr<Frontier> frontier;
+	runner.Run("Frontier/InsertErase", [&]() -> size_t
+	{
+		stage = SyntheticStage(Size(3840, 2160), 100000, 0.5, g);
+		shuffled = stage.frontier;
+		shuffle(shuffled.begin(), shuffled.end(), g);
+		frontier.reset(new Frontier(stage.image.size()));
+		return 2 * stage.frontier.size();
+	}, [&]()
+	{
+		for (const Pos& pos : stage.frontier)
+			frontier->Insert(pos);
+		for (const Pos& pos : shuffled)
+			frontier->Erase(pos);
+		sink = static_cast<double>(frontier->Size());
+	});
+
+	// Half filled canvases, items are pixels.
+	for (const Size& size : {Size(1920, 1080), Size(3840, 2160)})
+	{
+		string name = "Embellish/" + to_string(size.height) + "p";
+		runner.Run(name, [&]() -> size_t
+		{
+			stage = SyntheticStage(size, static_cast<size_t>(size.area()), 0.5, g);
+			return static_cast<size_t>(stage.image.total());
+		}, [&]()
+		{
+			Mat result = Embellish(stage.image);
+			sink = result.at<Color>(0, 0)[0];
+		});
+	}
+}
@@ -0,0 +1,198 @@
+// Reads the frames of an AllColors frame ring (--frame-ring=name) and
+// writes them as Y4M (4:4:4) to stdout, e.g.
+//   ./release/ring2y4m /allcolors | ffmpeg -i - -c:v libx264 output/video.mp4
+
+#include "../src/frame_ring_layout.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+
+// Set by SIGINT, SIGTERM and SIGHUP, so the reader deregisters before exiting.
+volatile sig_atomic_t stop = 0;
+
+void Stop(int)
+{
+	stop = 1;
+}
+
+void HandleSignals()
+{
+	// A closed pipe makes fwrite fail instead of killing the reader.
+	signal(SIGPIPE, SIG_IGN);
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = Stop;
+	sigemptyset(&action.sa_mask);
+	// No SA_RESTART, so a blocked write returns.
+	for (int signalNumber : {SIGINT, SIGTERM, SIGHUP})
+		sigaction(signalNumber, &action, nullptr);
+}
+
+// Waits until the producer has created and initialized the ring,
+// null if stopped meanwhile.
+FrameRingHeader* Attach(const char* name)
+{
+	while (!stop)
+	{
+		int fd = shm_open(name, O_RDWR, 0);
+		if (fd >= 0)
+		{
+			void* data = mmap(nullptr, sizeof(FrameRingHeader), PROT_READ | PROT_WRITE,
+							  MAP_SHARED, fd, 0);
+			FrameRingHeader* header = static_cast<FrameRingHeader*>(data);
+			if (data != MAP_FAILED && header->magic.load(memory_order_acquire) == frameRingMagic)
+			{
+				size_t size = FrameRingSize(*header);
+				munmap(data, sizeof(FrameRingHeader));
+				data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				close(fd);
+				return data == MAP_FAILED ? nullptr : static_cast<FrameRingHeader*>(data);
+			}
+			if (data != MAP_FAILED)
+				munmap(data, sizeof(FrameRingHeader));
+			close(fd);
+		}
+		this_thread::sleep_for(chrono::milliseconds(100));
+	}
+	return nullptr;
+}
+
+FrameRingConsumer* Register(FrameRingHeader* header)
+{
+	for (FrameRingConsumer& consumer : header->consumers)
+	{
+		uint32_t expected = 0;
+		if (!consumer.state.compare_exchange_strong(expected, 1))
+		{
+			// The slot of a dropped reader is free once its process is gone.
+			pid_t pid = consumer.pid.load(memory_order_relaxed);
+			if (expected != 3 || !(kill(pid, 0) && errno == ESRCH)
+				|| !consumer.state.compare_exchange_strong(expected, 1))
+				continue;
+		}
+		consumer.next.store(header->published.load(memory_order_acquire));
+		consumer.pid.store(getpid(), memory_order_relaxed);
+		consumer.state.store(2, memory_order_release);
+		return &consumer;
+	}
+	return nullptr;
+}
+
+// False once the producer has dropped this reader. The slot stays
+// reserved for it until Release, so a cursor update racing with the
+// drop only reaches its own slot, which the producer then ignores.
+bool StillRegistered(const FrameRingConsumer* consumer)
+{
+	return consumer->state.load(memory_order_acquire) == 2;
+}
+
+// Frees the slot, whether still active or dropped.
+void Release(FrameRingConsumer* consumer)
+{
+	uint32_t active = 2;
+	if (!consumer->state.compare_exchange_strong(active, 0))
+	{
+		uint32_t dropped = 3;
+		consumer->state.compare_exchange_strong(dropped, 0);
+	}
+}
+
+// BT.601, limited range.
+void BgrToYuv444(const unsigned char* bgr, size_t numPixels, vector<unsigned char>& yuv)
+{
+	unsigned char* y = yuv.data();
+	unsigned char* u = y + numPixels;
+	unsigned char* v = u + numPixels;
+	for (size_t i = 0; i < numPixels; ++i, bgr += 3)
+	{
+		int b = bgr[0], g = bgr[1], r = bgr[2];
+		y[i] = static_cast<unsigned char>(((66*r + 129*g + 25*b + 128) >> 8) + 16);
+		u[i] = static_cast<unsigned char>(((-38*r - 74*g + 112*b + 128) >> 8) + 128);
+		v[i] = static_cast<unsigned char>(((112*r - 94*g - 18*b + 128) >> 8) + 128);
+	}
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2)
+	{
+		cerr << "Usage: ring2y4m name > video.y4m" << endl;
+		return 1;
+	}
+	HandleSignals();
+	FrameRingHeader* header = Attach(argv[1]);
+	FrameRingConsumer* consumer = header ? Register(header) : nullptr;
+	if (!consumer)
+	{
+		cerr << "Could not attach to " << argv[1] << endl;
+		return 1;
+	}
+
+	const size_t numPixels = size_t(header->width) * header->height;
+	vector<unsigned char> yuv(numPixels * 3);
+	printf("YUV4MPEG2 W%u H%u F25:1 Ip A1:1 C444\n", header->width, header->height);
+	uint64_t n = consumer->next.load();
+	size_t dropped = 0;
+	while (!stop)
+	{
+		uint64_t published = header->published.load(memory_order_acquire);
+		if (n >= published)
+		{
+			if (header->finished.load(memory_order_acquire)
+				&& n >= header->published.load(memory_order_acquire))
+				break;
+			this_thread::sleep_for(chrono::milliseconds(1));
+			continue;
+		}
+		if (published - n > header->numSlots)
+		{
+			dropped += published - header->numSlots - n;
+			n = published - header->numSlots;
+		}
+		// Converted in place, valid if the slot was not rewritten meanwhile.
+		FrameRingSlot& slot = FrameRingSlots(header)[n % header->numSlots];
+		uint64_t sequence = slot.sequence.load(memory_order_acquire);
+		bool valid = sequence == 2 * n + 2;
+		if (valid)
+		{
+			BgrToYuv444(FrameRingFrame(header, n), numPixels, yuv);
+			atomic_thread_fence(memory_order_acquire);
+			valid = slot.sequence.load(memory_order_relaxed) == sequence;
+		}
+		if (valid)
+		{
+			fputs("FRAME\n", stdout);
+			if (fwrite(yuv.data(), 1, yuv.size(), stdout) != yuv.size())
+				break;
+		}
+		else
+			++dropped;
+		++n;
+		if (!StillRegistered(consumer))
+		{
+			cerr << "Dropped by producer" << endl;
+			break;
+		}
+		consumer->next.store(n, memory_order_release);
+	}
+	Release(consumer);
+	fflush(stdout);
+	cerr << n << " frames, " << dropped << " dropped" << endl;
+}